@@ -0,0 +1,238 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "Corpus.h"
+#include "AstPrinter.h"
+#include "OutputSink.h"
+#include "ParallelScanner.h"
+#include "Parser.h"
+#include "Scanner.h"
+#include "Stats.h"
+#include "Symbol.h"
+
+using namespace std;
+using namespace token;
+using namespace expr;
+
+// Command line switches of the benchmark
+struct Options {
+    size_t size = 1 << 20;   // bytes of script per corpus
+    size_t iterations = 15;  // timed runs per stage, after one warm-up run
+    uint64_t seed = 1;
+    bool json = false;       // one JSON object per line instead of a table
+    string_view only;        // run a single corpus
+    string_view emit;        // write a corpus to stdout instead of benchmarking
+};
+
+// Timings of one stage over one corpus
+struct Result {
+    string_view corpus;
+    string_view stage;
+    size_t bytes;           // input size
+    size_t items;           // tokens scanned, nodes built or bytes printed per run
+    string_view itemName;
+    size_t allocated;       // bytes allocated by one run once warmed up, worker threads included
+    vector<double> seconds; // one entry per timed run
+};
+
+// Counts the nodes of a tree, outside of any timed region.
+class NodeCounter : public Visitor<NodeCounter, size_t> {
+public:
+    size_t visitBinaryExpr(Binary* expr) {
+        // Down the left operands in a loop, so long chains cannot exhaust the stack.
+        size_t count = 0;
+        Expr* node = expr;
+        for (; node->kind == expr::ExprKind::BINARY; node = static_cast<Binary*>(node)->left) {
+            count += 1 + visit(static_cast<Binary*>(node)->right);
+        }
+        return count + visit(node);
+    }
+    size_t visitUnaryExpr(Unary* expr) { return 1 + visit(expr->right); }
+    size_t visitLiteralExpr(Literal*) { return 1; }
+    size_t visitGroupingExpr(Grouping* expr) { return 1 + visit(expr->expression); }
+    size_t visitVariableExpr(Variable*) { return 1; }
+};
+
+// Counting allocations costs a little, so the timed runs go without and one
+// more run afterwards is counted into `allocated`.
+template <typename Body>
+vector<double> time_runs(size_t iterations, Body body, size_t& allocated) {
+    body(); // warm-up: caches, arena chunks and the symbol table
+    vector<double> seconds;
+    seconds.reserve(iterations);
+    for (size_t i = 0; i < iterations; i++) {
+        auto start = chrono::steady_clock::now();
+        body();
+        seconds.push_back(chrono::duration<double>(chrono::steady_clock::now() - start).count());
+    }
+
+    stats::trackingAllocations = true;
+    stats::Allocations before = stats::currentAccount().read();
+    body();
+    allocated = stats::currentAccount().read().bytes - before.bytes;
+    stats::trackingAllocations = false;
+    return seconds;
+}
+
+// Nearest-rank percentile of the sorted run times.
+double percentile(const vector<double>& sorted, double fraction) {
+    size_t rank = static_cast<size_t>(fraction * sorted.size() + 0.999999);
+    return sorted[min(max<size_t>(rank, 1), sorted.size()) - 1];
+}
+
+void report(output::OutputSink& out, const Options& options, Result result) {
+    sort(result.seconds.begin(), result.seconds.end());
+    double median = percentile(result.seconds, 0.5);
+    double p99 = percentile(result.seconds, 0.99);
+    double megabytes = result.bytes / (1024.0 * 1024.0);
+
+    if (options.json) {
+        out << "{\"corpus\":";
+        out.jsonString(result.corpus);
+        out << ",\"stage\":";
+        out.jsonString(result.stage);
+        out << ",\"bytes\":" << result.bytes << ",\"iterations\":" << result.seconds.size();
+        out << ",\"median_ns\":";
+        out.shortest(median * 1e9);
+        out << ",\"p99_ns\":";
+        out.shortest(p99 * 1e9);
+        out << ",\"mb_per_s\":";
+        out.shortest(megabytes / median);
+        out << ",\"items\":" << result.items << ",\"item\":";
+        out.jsonString(result.itemName);
+        out << ",\"items_per_s\":";
+        out.shortest(result.items / median);
+        out << ",\"allocated_bytes\":" << result.allocated << "}\n";
+        return;
+    }
+
+    char line[160];
+    snprintf(line, sizeof(line), "%-12.*s %-7.*s %10.3f %10.3f %9.1f %12.3g %-7.*s %12zu\n",
+             static_cast<int>(result.corpus.size()), result.corpus.data(),
+             static_cast<int>(result.stage.size()), result.stage.data(),
+             median * 1e3, p99 * 1e3, megabytes / median, result.items / median,
+             static_cast<int>(result.itemName.size()), result.itemName.data(), result.allocated);
+    out << line;
+}
+
+void bench_corpus(output::OutputSink& out, const Options& options, const bench::CorpusInfo& info) {
+    string source = bench::generateCorpus(info.kind, options.size, options.seed);
+
+    // Scanner: every token, interning included.
+    size_t tokenCount = 0;
+    size_t scanAllocated = 0;
+    auto scanSeconds = time_runs(options.iterations, [&] {
+        scanner::Scanner scanner(source);
+        size_t count = 0;
+        for (auto& token : scanner) {
+            (void) token;
+            count++;
+        }
+        tokenCount = count;
+    }, scanAllocated);
+    report(out, options, { info.name, "scan", source.size(), tokenCount, "tokens", scanAllocated, scanSeconds });
+
+    // The same, split into chunks lexed on every hardware thread. Unlike the
+    // stage above this one has to keep the tokens, in one stitched vector.
+    concurrency::ThreadPool pool;
+    size_t parallelCount = 0;
+    size_t parallelAllocated = 0;
+    auto parallelSeconds = time_runs(options.iterations, [&] {
+        ostringstream diagnostics;
+        parallelCount = scanner::scanParallel(source, pool, diagnostics).size() - 1; // less END_OF_FILE
+    }, parallelAllocated);
+    report(out, options, { info.name, "scan-p", source.size(), parallelCount, "tokens", parallelAllocated, parallelSeconds });
+    if (!info.parses) return;
+
+    // Parser: from an already scanned token vector, so lexing is not counted twice.
+    vector<Token> tokens;
+    scanner::Scanner scanner(source);
+    for (auto& token : scanner) tokens.push_back(token);
+
+    AstArena arena;
+    vector<Expr*> trees;
+    size_t parseAllocated = 0;
+    auto parseSeconds = time_runs(options.iterations, [&] {
+        arena.reset();
+        trees.clear();
+        parser::Parser parser(tokens, arena);
+        while (Expr* expression = parser.next()) trees.push_back(expression);
+    }, parseAllocated);
+    size_t nodeCount = 0;
+    NodeCounter counter;
+    for (Expr* tree : trees) nodeCount += counter.visit(tree);
+    report(out, options, { info.name, "parse", source.size(), nodeCount, "nodes", parseAllocated, parseSeconds });
+
+    // Printer: the trees of the last parse, into a sink that only collects.
+    size_t printed = 0;
+    size_t printAllocated = 0;
+    auto printSeconds = time_runs(options.iterations, [&] {
+        output::OutputSink sink;
+        printer::AstPrinter printer(sink);
+        for (Expr* tree : trees) printer.print(tree);
+        printed = sink.buffered().size();
+    }, printAllocated);
+    report(out, options, { info.name, "print", source.size(), printed, "bytes", printAllocated, printSeconds });
+}
+
+int main(int argc, char **argv) {
+    Options options;
+    for (int i = 1; i < argc; i++) {
+        string_view arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--json") {
+            options.json = true;
+        } else if (arg == "--size" && hasValue) {
+            options.size = strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--iterations" && hasValue) {
+            options.iterations = max<size_t>(strtoull(argv[++i], nullptr, 10), 1);
+        } else if (arg == "--seed" && hasValue) {
+            options.seed = strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--corpus" && hasValue) {
+            options.only = argv[++i];
+        } else if (arg == "--emit" && hasValue) {
+            options.emit = argv[++i];
+        } else {
+            cout << "Usage: mac_bench [--size BYTES] [--iterations N] [--seed N] [--json] [--corpus NAME] [--emit NAME]" << endl;
+            return 64;
+        }
+    }
+
+    output::OutputSink out(stdout);
+    if (!options.emit.empty()) {
+        for (const auto& info : bench::corpora) {
+            if (info.name == options.emit) {
+                out << bench::generateCorpus(info.kind, options.size, options.seed);
+                return 0;
+            }
+        }
+        cout << "Unknown corpus: " << options.emit << endl;
+        return 64;
+    }
+
+    if (!options.json) {
+        char header[160];
+        snprintf(header, sizeof(header), "%-12s %-7s %10s %10s %9s %12s %-7s %12s\n",
+                 "corpus", "stage", "median ms", "p99 ms", "MB/s", "items/s", "item", "allocated");
+        out << header;
+    }
+    bool found = false;
+    for (const auto& info : bench::corpora) {
+        if (!options.only.empty() && info.name != options.only) continue;
+        found = true;
+        bench_corpus(out, options, info);
+        out.flush();
+    }
+    if (!found) {
+        cout << "Unknown corpus: " << options.only << endl;
+        return 64;
+    }
+    return 0;
+}
@@ -0,0 +1,101 @@
+#include "Corpus.h"
+
+namespace bench {
+
+static const char* const binaryOperators[] = { " + ", " - ", " * ", " / ", " < ", " >= ", " == ", " != " };
+static const char* const keywords[] = { "and", "class", "else", "for", "fun", "if", "or", "return", "var", "while" };
+
+static void appendNumber(string& out, Random& random) {
+    out += std::to_string(random.between(0, 99999));
+    if (random.between(0, 3) == 0) {
+        out += '.';
+        out += std::to_string(random.between(0, 999));
+    }
+}
+
+static void appendArithmetic(string& out, Random& random) {
+    size_t terms = random.between(16, 256);
+    appendNumber(out, random);
+    for (size_t i = 1; i < terms; i++) {
+        out += random.pick(binaryOperators);
+        if (random.between(0, 9) == 0) out += '-';
+        if (random.between(0, 7) == 0) {
+            out += '(';
+            appendNumber(out, random);
+            out += " * ";
+            appendNumber(out, random);
+            out += ')';
+        } else {
+            appendNumber(out, random);
+        }
+    }
+}
+
+static void appendNested(string& out, Random& random) {
+    // Left-nested: (((1 + 2) * 3) - 4). Deep enough to stress the recursive
+    // descent, shallow enough for the default stack.
+    size_t depth = random.between(32, 256);
+    out.append(depth, '(');
+    appendNumber(out, random);
+    for (size_t i = 0; i < depth; i++) {
+        out += random.pick(binaryOperators);
+        appendNumber(out, random);
+        out += ')';
+    }
+}
+
+static void appendString(string& out, Random& random) {
+    static const char alphabet[] = "abcdefghijklmnopqrstuvwxyz ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789";
+    static const char* const escapes[] = { "\\n", "\\t", "\\\"", "\\\\" };
+    out += '"';
+    size_t length = random.between(4, 48);
+    for (size_t i = 0; i < length; i++) {
+        if (random.between(0, 15) == 0) {
+            out += random.pick(escapes);
+        } else {
+            out += alphabet[random.next() % (sizeof(alphabet) - 1)];
+        }
+    }
+    out += '"';
+}
+
+static void appendStrings(string& out, Random& random) {
+    size_t terms = random.between(2, 12);
+    appendString(out, random);
+    for (size_t i = 1; i < terms; i++) {
+        out += random.between(0, 3) == 0 ? " == " : " + ";
+        appendString(out, random);
+    }
+}
+
+static void appendIdentifiers(string& out, Random& random) {
+    size_t words = random.between(4, 24);
+    for (size_t i = 0; i < words; i++) {
+        if (i > 0) out += random.between(0, 1) ? " " : random.pick(binaryOperators);
+        if (random.between(0, 5) == 0) {
+            out += random.pick(keywords);
+        } else {
+            // A few thousand distinct names, so most occurrences repeat one.
+            out += "name_";
+            out += std::to_string(random.between(0, 4095));
+        }
+    }
+}
+
+string generateCorpus(CorpusKind kind, size_t bytes, uint64_t seed) {
+    Random random(seed ^ (static_cast<uint64_t>(kind) + 1) * 0x2545f4914f6cdd1d);
+    string out;
+    out.reserve(bytes + 4096);
+    while (out.size() < bytes) {
+        switch (kind) {
+            case CorpusKind::ARITHMETIC: appendArithmetic(out, random); break;
+            case CorpusKind::NESTED: appendNested(out, random); break;
+            case CorpusKind::STRINGS: appendStrings(out, random); break;
+            case CorpusKind::IDENTIFIERS: appendIdentifiers(out, random); break;
+        }
+        out += '\n';
+    }
+    return out;
+}
+
+} // namespace bench
@@ -0,0 +1,67 @@
+#ifndef CORPUS_H
+#define CORPUS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+using std::string;
+using std::string_view;
+
+namespace bench {
+
+    /**
+     * Small deterministic generator (splitmix64). The standard distributions
+     * are allowed to differ between library implementations, so corpora are
+     * built from this alone to come out byte-for-byte the same everywhere.
+     */
+    class Random {
+    public:
+        explicit Random(uint64_t seed) : state(seed) {}
+
+        uint64_t next() {
+            uint64_t z = (state += 0x9e3779b97f4a7c15);
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+            return z ^ (z >> 31);
+        }
+
+        // Uniform in [low, high].
+        size_t between(size_t low, size_t high) { return low + next() % (high - low + 1); }
+
+        template <size_t N>
+        const char* pick(const char* const (&choices)[N]) { return choices[next() % N]; }
+
+    private:
+        uint64_t state;
+    };
+
+    enum class CorpusKind {
+        ARITHMETIC,  // long chains of binary operators over numbers
+        NESTED,      // deeply nested groupings
+        STRINGS,     // string literals, many with escapes, compared and concatenated
+        IDENTIFIERS, // identifiers and keywords; the grammar cannot parse these yet
+    };
+
+    struct CorpusInfo {
+        CorpusKind kind;
+        string_view name;
+        bool parses; // whether the parser accepts it (and so whether parse/print are timed)
+    };
+
+    inline constexpr CorpusInfo corpora[] = {
+        { CorpusKind::ARITHMETIC, "arithmetic", true },
+        { CorpusKind::NESTED, "nested", true },
+        { CorpusKind::STRINGS, "strings", true },
+        { CorpusKind::IDENTIFIERS, "identifiers", false },
+    };
+
+    // Generates at least `bytes` bytes of script, one expression per line.
+    // Every line starts with a token that cannot continue the previous
+    // expression, so the lines parse as separate top-level expressions.
+    string generateCorpus(CorpusKind kind, size_t bytes, uint64_t seed);
+
+} // namespace bench
+
+#endif /* CORPUS_H */
@@ -0,0 +1,108 @@
+#ifndef ASTARENA_H
+#define ASTARENA_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace expr {
+
+    /**
+     * Bump allocator that owns every node of a parse.
+     *
+     * Nodes are carved out of large chunks, so building a tree costs one
+     * malloc per chunk rather than one per node, and dropping the tree is a
+     * matter of releasing (or rewinding) the arena. Nodes are never destroyed
+     * one by one, which is why only trivially destructible types are accepted.
+     */
+    class AstArena {
+    public:
+        static constexpr size_t DEFAULT_CHUNK_SIZE = 64 * 1024;
+
+        // A position in the arena that can later be rewound to.
+        struct Mark {
+            size_t chunk;
+            size_t offset;
+        };
+
+        explicit AstArena(size_t chunkSize = DEFAULT_CHUNK_SIZE) : chunkSize(chunkSize) {}
+
+        AstArena(const AstArena&) = delete;
+        AstArena& operator=(const AstArena&) = delete;
+        AstArena(AstArena&&) = default;
+        AstArena& operator=(AstArena&&) = default;
+
+        template <typename T, typename... Args>
+        T* make(Args&&... args) {
+            static_assert(std::is_trivially_destructible_v<T>, "arena objects are released without running destructors");
+            void* memory = allocate(sizeof(T), alignof(T));
+            return new (memory) T(std::forward<Args>(args)...);
+        }
+
+        void* allocate(size_t size, size_t alignment) {
+            size_t aligned = (offset + alignment - 1) & ~(alignment - 1);
+            if (active < chunks.size() && aligned + size <= chunks[active].size) {
+                offset = aligned + size;
+                return chunks[active].memory.get() + aligned;
+            }
+            return allocateSlow(size, alignment);
+        }
+
+        Mark mark() const { return Mark { active, offset }; }
+
+        // Frees everything allocated after the mark in O(1); the chunks are kept for reuse.
+        void rewind(Mark mark) {
+            active = mark.chunk;
+            offset = mark.offset;
+        }
+
+        // Frees every node in O(1); the chunks are kept for reuse.
+        void reset() { rewind(Mark { 0, 0 }); }
+
+        // Returns the chunks themselves to the system.
+        void release() {
+            chunks.clear();
+            reset();
+        }
+
+        size_t chunkCount() const { return chunks.size(); }
+
+        size_t bytesReserved() const {
+            size_t total = 0;
+            for (const Chunk& chunk : chunks) total += chunk.size;
+            return total;
+        }
+
+    private:
+        struct Chunk {
+            std::unique_ptr<std::byte[]> memory;
+            size_t size;
+        };
+
+        std::vector<Chunk> chunks;
+        size_t chunkSize;
+        size_t active = 0; // chunk currently being bumped through
+        size_t offset = 0; // first free byte in the active chunk
+
+        void* allocateSlow(size_t size, size_t alignment) {
+            // Move on to the next chunk that fits, reusing chunks left over from a
+            // rewind before asking for a new one. new[] is aligned for any node type.
+            size_t next = active < chunks.size() ? active + 1 : active;
+            while (next < chunks.size() && chunks[next].size < size) next++;
+            if (next == chunks.size()) {
+                size_t bytes = size + alignment > chunkSize ? size + alignment : chunkSize;
+                chunks.push_back(Chunk { std::unique_ptr<std::byte[]>(new std::byte[bytes]), bytes });
+            }
+            active = next;
+            offset = 0;
+            return allocate(size, alignment);
+        }
+    };
+
+} // namespace expr
+
+#endif /* ASTARENA_H */
@@ -0,0 +1,88 @@
+#ifndef ASTCACHE_H
+#define ASTCACHE_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include "AstArena.h"
+#include "Expr.h"
+#include "FlatAst.h"
+#include "Source.h"
+
+using std::string;
+using std::string_view;
+
+namespace cache {
+
+    // Bumped whenever the file layout or the meaning of a node changes;
+    // files written by any other version are ignored and rewritten.
+    constexpr uint32_t FORMAT_VERSION = 4;
+
+    // 128-bit hash of a script's text, which names its cache file.
+    struct ContentHash {
+        uint64_t low;
+        uint64_t high;
+
+        friend bool operator==(const ContentHash&, const ContentHash&) = default;
+    };
+
+    ContentHash contentHash(string_view source);
+
+    // A parsed script as the cache hands it out. String constants of a tree
+    // that was loaded point into the mapped file, which this keeps open.
+    class CachedAst {
+    public:
+        const flat::FlatAst& ast() const { return tree; }
+        // Whether the tree came from the cache rather than from the parser.
+        bool loaded() const { return file != nullptr; }
+
+    private:
+        friend class AstCache;
+
+        std::unique_ptr<source::SourceFile> file;
+        flat::FlatAst tree;
+    };
+
+    /**
+     * Parsed scripts saved as flat::FlatAst files under a directory, one per
+     * distinct script text, so a script that has not changed since it was
+     * last run is never scanned or parsed again.
+     *
+     * A file holds a header (format version, content hash and length of the
+     * source, section sizes) followed by the node arrays exactly as they are
+     * laid out in memory, a constant pool whose strings are stored inline,
+     * and the source text itself. Loading maps the file, checks the header,
+     * compares the stored text with the script byte for byte (so a hash
+     * collision is a miss, not someone else's tree), checks every node, and
+     * copies the arrays out in bulk. A changed script hashes to a different file,
+     * and a file from another format version is rejected and overwritten,
+     * so nothing ever has to be invalidated by hand.
+     */
+    class AstCache {
+    public:
+        explicit AstCache(string directory) : directory(std::move(directory)) {}
+
+        // The tree of `source`: loaded if this exact text was cached before,
+        // otherwise parsed and saved. Scripts with lexical or syntax errors
+        // are not cached; for them null is returned and nothing is printed,
+        // so the caller can process them the usual way.
+        std::unique_ptr<CachedAst> get(string_view source) const;
+
+        string pathFor(const ContentHash& hash) const;
+
+    private:
+        string directory;
+
+        std::unique_ptr<CachedAst> load(const ContentHash& hash, string_view source) const;
+        bool store(const ContentHash& hash, string_view source, const flat::FlatAst& ast) const;
+    };
+
+    // Rebuilds the pointer tree of one root of a FlatAst in the arena, for
+    // the passes that walk trees (printing, folding, evaluation).
+    expr::Expr* expand(const flat::FlatAst& ast, size_t rootIndex, expr::AstArena& arena);
+
+} // namespace cache
+
+#endif /* ASTCACHE_H */
@@ -2,62 +2,228 @@
 #define ASTPRINTER_H
 
 #include <string>
-#include <sstream>
+#include <string_view>
 #include <memory>
+#include <vector>
 #include "Expr.h"
+#include "FlatAst.h"
+#include "OutputSink.h"
 
 using expr::Visitor;
 using std::string;
+using std::string_view;
 using std::shared_ptr;
 
 namespace printer {
 
-    class AstPrinter : public Visitor, public std::enable_shared_from_this<AstPrinter> {
+    enum class Format {
+        SEXPR, // (+ 1.000000 (group 2.000000))
+        JSON,  // {"binary":"+","left":{"literal":1},"right":{"group":{"literal":2}}}
+    };
+
+    // Writes a literal the way expr::Literal::toString() spells it.
+    inline void printLiteral(output::OutputSink& out, const TokenValue& value) {
+        if (token::isText(value)) {
+            out << token::textOf(value);
+        } else if (token::isNumber(value)) {
+            out.fixed(token::numberOf(value));
+        } else if (std::holds_alternative<bool>(value)) {
+            out << (std::get<bool>(value) ? "true" : "false");
+        } else {
+            out << "nil";
+        }
+    }
+
+    inline void printJsonLiteral(output::OutputSink& out, const TokenValue& value) {
+        out << "{\"literal\":";
+        if (token::isText(value)) {
+            out.jsonString(token::textOf(value));
+        } else if (token::isNumber(value)) {
+            out.shortest(token::numberOf(value));
+        } else if (std::holds_alternative<bool>(value)) {
+            out << (std::get<bool>(value) ? "true" : "false");
+        } else {
+            out << "null";
+        }
+        out << '}';
+    }
+
+    /**
+     * Prints expression trees straight into an OutputSink, one expression per
+     * line, either as S-expressions or as JSON lines. Nothing is built up per
+     * node: the text goes out in the order it is visited.
+     */
+    class AstPrinter : public Visitor<AstPrinter, void> {
     public:
-        string visitBinaryExpr(expr::Binary* expr) override {
-            return parenthesize(get<string>(expr->operatorToken.lexeme), expr->left, expr->right);
+        explicit AstPrinter(output::OutputSink& out, Format format = Format::SEXPR) : out(out), format(format) {}
+
+        void print(expr::Expr* expr) {
+            spine.clear();
+            visit(expr);
+            out << '\n';
+        }
+
+        // A chain is printed in a loop: every opening, the innermost left
+        // operand, then every right operand with its closing.
+        void visitBinaryExpr(expr::Binary* expr) {
+            bool json = format == Format::JSON;
+            size_t base = spine.size();
+            expr::Expr* bottom = expr::leftSpine(expr, spine);
+            for (size_t i = base; i < spine.size(); i++) {
+                if (json) {
+                    out << "{\"binary\":";
+                    out.jsonString(spine[i]->operatorToken.text());
+                    out << ",\"left\":";
+                } else {
+                    out << '(' << spine[i]->operatorToken.text() << ' ';
+                }
+            }
+            visit(bottom);
+            for (size_t i = spine.size(); i-- > base;) {
+                out << (json ? ",\"right\":" : " ");
+                visit(spine[i]->right);
+                out << (json ? '}' : ')');
+            }
+            spine.resize(base);
         }
 
-        string visitUnaryExpr(expr::Unary* expr) override {
-            return expr->operatorToken.type == TokenType::NUMBER
-                ? parenthesize(get<double>(expr->operatorToken.lexeme), expr->right)
-                : parenthesize(get<string>(expr->operatorToken.lexeme), expr->right);
+        void visitUnaryExpr(expr::Unary* expr) {
+            if (format == Format::JSON) {
+                out << "{\"unary\":";
+                out.jsonString(expr->operatorToken.text());
+                out << ",\"operand\":";
+                visit(expr->right);
+                out << '}';
+                return;
+            }
+            parenthesize(expr->operatorToken.text(), expr->right);
         }
 
-        string visitLiteralExpr(expr::Literal* expr) override {
-            if (expr == nullptr) return "nil";
-            return expr->toString();
+        void visitLiteralExpr(expr::Literal* expr) {
+            if (format == Format::JSON) {
+                printJsonLiteral(out, expr->value);
+            } else {
+                printLiteral(out, expr->value);
+            }
         }
 
-        string visitVariableExpr(expr::Variable* expr) override {
-            return get<string>(expr->name.lexeme);
+        void visitVariableExpr(expr::Variable* expr) {
+            if (format == Format::JSON) {
+                out << "{\"variable\":";
+                out.jsonString(expr->name.view());
+                out << '}';
+            } else {
+                out << expr->name.view();
+            }
         }
 
-        string visitGroupingExpr(expr::Grouping* expr) override {
-            return parenthesize("group", expr->expression);
+        void visitGroupingExpr(expr::Grouping* expr) {
+            if (format == Format::JSON) {
+                out << "{\"group\":";
+                visit(expr->expression);
+                out << '}';
+                return;
+            }
+            parenthesize("group", expr->expression);
         }
 
     private:
+        output::OutputSink& out;
+        Format format;
+        std::vector<expr::Binary*> spine; // see expr::leftSpine()
+
         template <typename... Exprs>
-        string parenthesize(const std::string& name, shared_ptr<Exprs>... exprs) {
-            std::ostringstream output;
-            output << "(" << name;
+        void parenthesize(string_view name, Exprs*... exprs) {
+            out << '(' << name;
             // C++17 fold expression to expand variadic arguments
-            ((output << " " << exprs->visit(this->shared_from_this())), ...);
-            output << ")";
-            return output.str();
+            ((out << ' ', visit(exprs)), ...);
+            out << ')';
+        }
+    };
+
+    /**
+     * Prints a flat::FlatAst in the same forms as AstPrinter, reading the
+     * node arrays by index.
+     */
+    class FlatAstPrinter {
+    public:
+        explicit FlatAstPrinter(const flat::FlatAst& ast, output::OutputSink& out, Format format = Format::SEXPR)
+            : ast(ast), out(out), format(format) {}
+
+        void print(size_t rootIndex) {
+            spine.clear();
+            visit(ast.roots[rootIndex]);
+            out << '\n';
         }
 
-        // Overload for numeric values
-        string parenthesize(double numericValue, shared_ptr<expr::Expr> expr) {
-            std::ostringstream output;
-            output << "(" << numericValue;
-            output << " " << expr->visit(this->shared_from_this());
-            output << ")";
-            return output.str();
+    private:
+        const flat::FlatAst& ast;
+        output::OutputSink& out;
+        Format format;
+        std::vector<flat::NodeId> spine; // as in AstPrinter
+
+        void visit(flat::NodeId node) {
+            bool json = format == Format::JSON;
+            switch (ast.kinds[node]) {
+                case flat::NodeKind::BINARY: {
+                    size_t base = spine.size();
+                    for (; ast.kinds[node] == flat::NodeKind::BINARY; node = ast.lhs[node]) {
+                        spine.push_back(node);
+                        if (json) {
+                            out << "{\"binary\":";
+                            out.jsonString(token::spelling(ast.op(node)));
+                            out << ",\"left\":";
+                        } else {
+                            out << '(' << token::spelling(ast.op(node)) << ' ';
+                        }
+                    }
+                    visit(node);
+                    for (size_t i = spine.size(); i-- > base;) {
+                        out << (json ? ",\"right\":" : " ");
+                        visit(ast.rhs[spine[i]]);
+                        out << (json ? '}' : ')');
+                    }
+                    spine.resize(base);
+                    break;
+                }
+                case flat::NodeKind::UNARY:
+                    if (json) {
+                        out << "{\"unary\":";
+                        out.jsonString(token::spelling(ast.op(node)));
+                        out << ",\"operand\":";
+                        visit(ast.lhs[node]);
+                        out << '}';
+                    } else {
+                        out << '(' << token::spelling(ast.op(node)) << ' ';
+                        visit(ast.lhs[node]);
+                        out << ')';
+                    }
+                    break;
+                case flat::NodeKind::GROUPING:
+                    out << (json ? "{\"group\":" : "(group ");
+                    visit(ast.lhs[node]);
+                    out << (json ? '}' : ')');
+                    break;
+                case flat::NodeKind::LITERAL:
+                    if (json) {
+                        printJsonLiteral(out, ast.constants[ast.lhs[node]]);
+                    } else {
+                        printLiteral(out, ast.constants[ast.lhs[node]]);
+                    }
+                    break;
+                case flat::NodeKind::VARIABLE:
+                    if (json) {
+                        out << "{\"variable\":";
+                        out.jsonString(token::textOf(ast.constants[ast.lhs[node]]));
+                        out << '}';
+                    } else {
+                        out << token::textOf(ast.constants[ast.lhs[node]]);
+                    }
+                    break;
+            }
         }
     };
 
 } // end namespace printer
 
-#endif // ASTPRINTER_H
\ No newline at end of file
+#endif // ASTPRINTER_H
@@ -0,0 +1,45 @@
+#ifndef CHARCLASS_H
+#define CHARCLASS_H
+
+#include <array>
+#include <cstdint>
+
+namespace scanner {
+
+    // Character classes are bit flags so a single table load answers
+    // "is this whitespace / a digit / an identifier character" at once.
+    enum CharClass : uint8_t {
+        CC_NONE     = 0,
+        CC_SPACE    = 1 << 0, // ' ', '\t' and '\r'
+        CC_NEWLINE  = 1 << 1, // '\n'
+        CC_DIGIT    = 1 << 2, // '0'-'9'
+        CC_ALPHA    = 1 << 3, // 'a'-'z', 'A'-'Z' and '_'
+
+        CC_BLANK      = CC_SPACE | CC_NEWLINE,
+        CC_IDENTIFIER = CC_ALPHA | CC_DIGIT,
+    };
+
+    constexpr std::array<uint8_t, 256> makeCharClassTable() {
+        std::array<uint8_t, 256> table {};
+        table[' '] = table['\t'] = table['\r'] = CC_SPACE;
+        table['\n'] = CC_NEWLINE;
+        for (int c = '0'; c <= '9'; c++) table[c] = CC_DIGIT;
+        for (int c = 'a'; c <= 'z'; c++) table[c] = CC_ALPHA;
+        for (int c = 'A'; c <= 'Z'; c++) table[c] = CC_ALPHA;
+        table['_'] = CC_ALPHA;
+        return table;
+    }
+
+    inline constexpr std::array<uint8_t, 256> charClassTable = makeCharClassTable();
+
+    constexpr uint8_t charClass(char c) {
+        return charClassTable[static_cast<unsigned char>(c)];
+    }
+
+    static_assert(charClass('_') == CC_ALPHA);
+    static_assert(charClass('\n') == CC_NEWLINE);
+    static_assert(charClass('\xff') == CC_NONE);
+
+} // namespace scanner
+
+#endif /* CHARCLASS_H */
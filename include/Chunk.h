@@ -0,0 +1,93 @@
+#ifndef CHUNK_H
+#define CHUNK_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "Value.h"
+
+using runtime::Value;
+
+namespace bytecode {
+
+    // The order matters: the VM's dispatch table is laid out in the same order.
+    enum class OpCode : uint8_t {
+        CONSTANT,      // [index u8]     push constants[index]
+        CONSTANT_LONG, // [index u24]    push constants[index]
+        NIL,
+        TRUE,
+        FALSE,
+        GET_GLOBAL,    // [index u24]    push the global named by constants[index]
+        NEGATE,
+        NOT,
+        ADD,
+        SUBTRACT,
+        MULTIPLY,
+        DIVIDE,
+        EQUAL,
+        NOT_EQUAL,
+        GREATER,
+        GREATER_EQUAL,
+        LESS,
+        LESS_EQUAL,
+        PRINT,         // pop and print the value of a top-level expression
+        RETURN,
+    };
+
+    // Marks the first instruction that came from a new source position.
+    struct SourceMark {
+        uint32_t code;   // offset into Chunk::code
+        uint32_t source; // byte offset of the token in the script
+    };
+
+    /**
+     * A compiled script: the instruction stream, its constant pool and a
+     * run-length encoded table of source offsets (one entry per change of
+     * position rather than one per byte). Lines and columns are worked out
+     * from the offset only when an error needs them.
+     */
+    class Chunk {
+    public:
+        std::vector<uint8_t> code;
+        std::vector<Value> constants;
+        std::vector<SourceMark> marks;
+        // Deepest the value stack gets while running the chunk, worked out by the compiler.
+        uint32_t maxStack = 0;
+
+        void write(uint8_t byte, uint32_t source) {
+            if (marks.empty() || marks.back().source != source) {
+                marks.push_back(SourceMark { static_cast<uint32_t>(code.size()), source });
+            }
+            code.push_back(byte);
+        }
+
+        void write(OpCode op, uint32_t source) { write(static_cast<uint8_t>(op), source); }
+
+        uint32_t addConstant(Value value) {
+            constants.push_back(value);
+            return static_cast<uint32_t>(constants.size() - 1);
+        }
+
+        // Source offset of the instruction at the given code offset.
+        uint32_t sourceOffsetAt(size_t offset) const {
+            // Last entry that starts at or before the offset.
+            size_t low = 0, high = marks.size();
+            while (high - low > 1) {
+                size_t middle = (low + high) / 2;
+                if (marks[middle].code <= offset) low = middle; else high = middle;
+            }
+            return marks.empty() ? 0 : marks[low].source;
+        }
+
+        void clear() {
+            code.clear();
+            constants.clear();
+            marks.clear();
+            maxStack = 0;
+        }
+    };
+
+} // namespace bytecode
+
+#endif /* CHUNK_H */
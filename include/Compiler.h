@@ -0,0 +1,77 @@
+#ifndef COMPILER_H
+#define COMPILER_H
+
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Chunk.h"
+#include "Expr.h"
+#include "Value.h"
+
+using expr::Visitor;
+
+namespace bytecode {
+
+    // A script that does not fit the bytecode, such as one with more
+    // constants than a 24-bit index reaches.
+    class CompileError : public std::runtime_error {
+    public:
+        CompileError(uint32_t offset, const std::string& message) : std::runtime_error(message), offset(offset) {}
+
+        uint32_t offset; // in the source
+    };
+
+    /**
+     * Lowers expression trees into a Chunk for the VM. Each top-level
+     * expression compiles to the code that computes it followed by PRINT, so
+     * a whole script becomes one straight-line chunk ending in RETURN.
+     * compile() throws a CompileError when the chunk runs out of constant
+     * indices, and the chunk is then unusable.
+     */
+    class Compiler : public Visitor<Compiler, void> {
+    public:
+        // String constants are created in the heap, which has to outlive the chunk.
+        Compiler(Chunk& chunk, runtime::Heap& heap) : chunk(chunk), heap(heap) {}
+
+        void compile(expr::Expr* expression);
+        void finish();
+
+        void visitBinaryExpr(expr::Binary* expr);
+        void visitUnaryExpr(expr::Unary* expr);
+        void visitLiteralExpr(expr::Literal* expr);
+        void visitGroupingExpr(expr::Grouping* expr);
+        void visitVariableExpr(expr::Variable* expr);
+
+    private:
+        static constexpr uint32_t MAX_INDEX = (1u << 24) - 1; // of CONSTANT_LONG and GET_GLOBAL
+
+        Chunk& chunk;
+        runtime::Heap& heap;
+        uint32_t offset = 0;   // source offset of the last token seen, for nodes without one
+        uint32_t depth = 0;    // values on the stack at this point of the code
+        // Constant slot of each symbol already used, so repeated names and
+        // literals share one string constant.
+        std::unordered_map<uint32_t, uint32_t> symbolConstants;
+        // The same for numbers, by their Value bits, so 1 and 1.0 (or 0 and
+        // -0) stay apart.
+        std::unordered_map<uint64_t, uint32_t> numberConstants;
+        std::vector<expr::Binary*> spine; // see expr::leftSpine()
+
+        void emit(OpCode op) { chunk.write(op, offset); }
+        void emitConstant(Value value);
+        void emitConstant(uint32_t index);
+        uint32_t symbolConstant(symbol::Symbol symbol);
+        uint32_t numberConstant(Value value);
+        void emitIndexed(OpCode op, uint32_t index);
+        // The right operand and the operator, the left operand being on the stack.
+        void binary(expr::Binary* expr);
+        void pushed(uint32_t count = 1);
+        void popped(uint32_t count = 1) { depth -= count; }
+    };
+
+} // namespace bytecode
+
+#endif /* COMPILER_H */
@@ -0,0 +1,76 @@
+#ifndef CONSTANTFOLDER_H
+#define CONSTANTFOLDER_H
+
+#include <cstddef>
+#include <unordered_map>
+#include <vector>
+
+#include "AstArena.h"
+#include "Expr.h"
+
+using expr::Expr;
+using expr::Visitor;
+
+namespace optimizer {
+
+    struct FoldStats {
+        size_t foldedNodes = 0;       // operator nodes replaced by the literal they compute
+        size_t strippedGroupings = 0; // parentheses dropped from the tree
+        size_t simplifiedNodes = 0;   // nodes removed by algebraic identities
+    };
+
+    /**
+     * Constant folding and algebraic simplification over expression trees.
+     *
+     * Subtrees whose operands are all literals are replaced by the literal
+     * they evaluate to, using exactly the interpreter's rules (IEEE doubles,
+     * integer results of integer operands kept as integers, its equality and
+     * truthiness), and Grouping nodes are dropped since the
+     * tree already encodes precedence. A few identities are applied when they
+     * cannot change the result: -(-x) and x * 1, 1 * x, x / 1, x - 0 for
+     * operands that are known to be numbers, and !!x for operands known to be
+     * booleans. Anything that would raise a runtime error is left alone so the
+     * error still happens at runtime. (x + 0 is deliberately not simplified:
+     * -0 + 0 is +0.)
+     *
+     * Nodes are rewritten in place and new literals come from the arena.
+     * Folded string concatenations are interned like any other literal.
+     *
+     * Trees that share nodes, such as those of an expr::HashConsBuilder,
+     * need `shared`: then no node is changed, a node whose children changed
+     * is copied instead, and each shared node is folded only once, with the
+     * same result everywhere it is used. The copies are not hash-consed.
+     */
+    class ConstantFolder : public Visitor<ConstantFolder, Expr*> {
+    public:
+        explicit ConstantFolder(expr::AstArena& arena, bool shared = false) : arena(arena), shared(shared) {}
+
+        Expr* fold(Expr* expression) {
+            spine.clear();
+            return child(expression);
+        }
+        const FoldStats& stats() const { return counts; }
+
+        Expr* visitBinaryExpr(expr::Binary* expr);
+        Expr* visitUnaryExpr(expr::Unary* expr);
+        Expr* visitLiteralExpr(expr::Literal* expr);
+        Expr* visitGroupingExpr(expr::Grouping* expr);
+        Expr* visitVariableExpr(expr::Variable* expr);
+
+    private:
+        expr::AstArena& arena;
+        bool shared;
+        FoldStats counts;
+        // With `shared`, what each node already visited folded to.
+        std::unordered_map<Expr*, Expr*> folded;
+        std::vector<expr::Binary*> spine; // see expr::leftSpine()
+
+        Expr* child(Expr* expression);
+        // One operator of a chain, given what its left operand folded to.
+        Expr* binary(expr::Binary* expr, Expr* foldedLeft);
+        Expr* literal(TokenValue value);
+    };
+
+} // namespace optimizer
+
+#endif /* CONSTANTFOLDER_H */
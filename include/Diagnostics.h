@@ -0,0 +1,68 @@
+#ifndef DIAGNOSTICS_H
+#define DIAGNOSTICS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "LineIndex.h"
+
+using std::string;
+
+namespace diagnostics {
+
+    // The phase that found the error.
+    enum class Stage {
+        LEXICAL, // unexpected character, unterminated string
+        SYNTAX,  // the parser's errors
+        COMPILE, // limits of the bytecode, e.g. too many constants
+        RUNTIME, // errors raised while evaluating
+        INTERNAL, // failures not caused by the script, e.g. running out of resources
+    };
+
+    struct Diagnostic {
+        Stage stage;
+        uint32_t offset; // where in the source
+        string message;
+        // Filled in by Diagnostics::locate().
+        int line = 0;
+        int column = 0;
+    };
+
+    /**
+     * Errors collected while a script is processed, in the order they were
+     * found, for callers that report them their own way instead of having
+     * the scanner and parser print them.
+     */
+    class Diagnostics {
+    public:
+        void report(Stage stage, uint32_t offset, string message) {
+            found.push_back(Diagnostic { stage, offset, std::move(message) });
+        }
+
+        // Works out the line and column of every error from its offset.
+        void locate(const source::LineIndex& lines) {
+            for (Diagnostic& diagnostic : found) {
+                source::Position position = lines.position(diagnostic.offset);
+                diagnostic.line = position.line;
+                diagnostic.column = position.column;
+            }
+        }
+
+        bool empty() const { return found.empty(); }
+        size_t size() const { return found.size(); }
+        const Diagnostic& operator[](size_t index) const { return found[index]; }
+        std::vector<Diagnostic>::const_iterator begin() const { return found.begin(); }
+        std::vector<Diagnostic>::const_iterator end() const { return found.end(); }
+
+        void clear() { found.clear(); }
+        std::vector<Diagnostic> take() { return std::move(found); }
+
+    private:
+        std::vector<Diagnostic> found;
+    };
+
+} // namespace diagnostics
+
+#endif /* DIAGNOSTICS_H */
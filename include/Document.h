@@ -0,0 +1,108 @@
+#ifndef DOCUMENT_H
+#define DOCUMENT_H
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "AstArena.h"
+#include "Diagnostics.h"
+#include "Expr.h"
+#include "Token.h"
+
+using std::string;
+using std::string_view;
+using diagnostics::Diagnostic;
+using token::Token;
+
+namespace incremental {
+
+    /**
+     * One top-level expression of a Document: its text (the expression plus
+     * the blanks and comments that follow it), its tokens and its tree.
+     *
+     * Token and error offsets are relative to the start of the segment's
+     * text, and no lexeme points into the text. A segment is therefore still valid,
+     * unchanged, when edits elsewhere move it around the document, and is
+     * only rebuilt when its own tokens change.
+     */
+    struct Segment {
+        string text;
+        int newlines = 0;          // '\n' in text
+        std::vector<Token> tokens;
+        std::vector<Diagnostic> lexicalErrors; // one per NONE token, at relative offsets
+        expr::Expr* root = nullptr; // null if the expression has a syntax error
+        // The syntax error, if any; errorAtEnd means the expression was cut
+        // short by the end of the document (the rest may still be typed).
+        string error;
+        uint32_t errorOffset = 0;
+        bool errorAtEnd = false;
+        std::unique_ptr<expr::AstArena> arena; // owns root's nodes
+    };
+
+    // Segments [first, first + removed) were replaced by [first, first + inserted);
+    // the segments around them still hold the trees they had.
+    struct EditResult {
+        size_t first = 0;
+        size_t removed = 0;
+        size_t inserted = 0;
+    };
+
+    /**
+     * A script kept lexed and parsed across edits, for the REPL and editors.
+     *
+     * An edit re-lexes and re-parses only a window of whole segments: the
+     * ones the edit touches plus the one before (whose expression might now
+     * continue into the edited text), widened only while the new tokens or
+     * the new expressions run into the segments around the window. Segments
+     * whose tokens come out unchanged are kept as they are, tree included,
+     * and only pick up their new trailing blanks. The only work outside the
+     * window is adding up segment lengths to find it.
+     *
+     * seal() fixes the segments at the front for good, as the REPL does with
+     * each expression once it has run: they are dropped, no later edit can
+     * change them, and no expression can continue from them. Sizes, offsets
+     * and edits then cover only the text after them, while lines and columns
+     * still count them. So a REPL that seals what it runs only ever edits its
+     * unfinished expression, however long the session.
+     */
+    class Document {
+    public:
+        explicit Document(string_view text = string_view());
+
+        // Replaces `length` bytes at `offset` with `replacement`.
+        EditResult edit(size_t offset, size_t length, string_view replacement);
+        EditResult append(string_view text) { return edit(size(), 0, text); }
+        // Drops the first `count` segments for good (see above).
+        void seal(size_t count);
+
+        size_t size() const { return length; }
+        string text() const;
+
+        size_t segmentCount() const { return segments.size(); }
+        const Segment& segment(size_t index) const { return *segments[index]; }
+        // Byte offset of the segment's text in the document.
+        size_t offset(size_t index) const;
+        // Absolute line the segment starts on.
+        int firstLine(size_t index) const;
+        // Line and column of an offset relative to the segment, as found in its
+        // tokens, nodes and errors.
+        source::Position position(size_t index, uint32_t offset) const;
+        // The segment's lexical errors and then its syntax error, at absolute
+        // offsets with their lines and columns filled in.
+        std::vector<Diagnostic> diagnostics(size_t index) const;
+
+    private:
+        std::vector<std::unique_ptr<Segment>> segments;
+        size_t length = 0;
+        // Where the sealed text left off: its lines, and the bytes after its
+        // last newline.
+        int sealedLines = 0;
+        size_t sealedColumn = 0;
+    };
+
+} // namespace incremental
+
+#endif /* DOCUMENT_H */
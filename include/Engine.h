@@ -0,0 +1,71 @@
+#ifndef ENGINE_H
+#define ENGINE_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "AstArena.h"
+#include "Chunk.h"
+#include "Diagnostics.h"
+#include "Expr.h"
+#include "Symbol.h"
+#include "Token.h"
+
+using std::string;
+using std::string_view;
+using token::Token;
+
+namespace engine {
+
+    struct Options {
+        // Run on the bytecode VM rather than the tree-walking interpreter
+        bool vm = true;
+        // Fold constants and simplify each tree before it runs
+        bool fold = false;
+    };
+
+    // What running a script produced: the values it printed and its errors.
+    struct Result {
+        string output;
+        std::vector<diagnostics::Diagnostic> diagnostics;
+
+        bool ok() const { return diagnostics.empty(); }
+    };
+
+    /**
+     * Scans, parses and runs Mac source inside the calling program. Nothing
+     * is printed and nothing exits: every lexical, syntax and runtime error
+     * comes back as a Diagnostic, and the parser recovers from syntax errors
+     * so one call reports all of them.
+     *
+     * An engine keeps its arena and bytecode buffers from one call to the
+     * next, so a warm engine runs small scripts with few allocations. It
+     * interns names and strings into a symbol table of its own, which each
+     * call clears, so an engine that lives long does not keep every name it
+     * ever saw. It is not thread-safe; use one engine per thread.
+     */
+    class Engine {
+    public:
+        explicit Engine(Options options = Options()) : options(options) {}
+
+        // The tokens up to END_OF_FILE. Lexemes point into `source`, and
+        // symbols into the engine; both are valid until its next call.
+        std::vector<Token> scan(string_view source, diagnostics::Diagnostics& errors);
+        // The top-level expressions that parsed. The trees live in the engine
+        // and are valid until its next call.
+        std::vector<expr::Expr*> parse(string_view source, diagnostics::Diagnostics& errors);
+        // Runs the script if it scans and parses cleanly, up to the first
+        // runtime error.
+        Result run(string_view source);
+
+    private:
+        Options options;
+        expr::AstArena arena;
+        bytecode::Chunk chunk;
+        symbol::SymbolTable symbols;
+    };
+
+} // namespace engine
+
+#endif /* ENGINE_H */
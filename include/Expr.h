@@ -2,14 +2,20 @@
 #define EXPR_H
 
 #include "Token.h"
+#include "AstArena.h"
+#include <cstdint>
+#include <utility>
 #include <variant>
 #include <string>
+#include <string_view>
 #include <memory>
+#include <vector>
 
 using token::Token;
 using token::TokenValue;
 
 using std::string;
+using std::string_view;
 using std::variant;
 using std::shared_ptr;
 using std::make_shared;
@@ -23,62 +29,58 @@ namespace expr {
     class Grouping;
     class Variable;
 
-    class Visitor {
-    public:
-        virtual string visitBinaryExpr(Binary* expr) = 0;
-        virtual string visitUnaryExpr(Unary* expr) = 0;
-        virtual string visitLiteralExpr(Literal* expr) = 0;
-        virtual string visitGroupingExpr(Grouping* expr) = 0;
-        virtual string visitVariableExpr(Variable* expr) = 0;
+    enum class ExprKind : uint8_t {
+        BINARY,
+        UNARY,
+        LITERAL,
+        GROUPING,
+        VARIABLE,
     };
 
+    // Nodes are allocated from an AstArena and refer to their children by raw
+    // pointer; the arena owns them all and frees them together.
+    // The kind tag replaces a vtable: visitors switch on it (see Visitor below).
     class Expr {
     public:
-        virtual string visit(shared_ptr<Visitor> visitor) = 0;
+        explicit Expr(ExprKind kind) : kind(kind) {}
+
+        const ExprKind kind;
     };
 
     class Binary : public Expr {
     public:
-        Binary(shared_ptr<Expr> left, Token operatorToken, shared_ptr<Expr> right)
-            : left(left), operatorToken(operatorToken), right(right) {}
-
-        string visit(shared_ptr<Visitor> visitor) override {
-            return visitor->visitBinaryExpr(this);
-        }
+        Binary(Expr* left, Token operatorToken, Expr* right)
+            : Expr(ExprKind::BINARY), left(left), operatorToken(operatorToken), right(right) {}
 
-        shared_ptr<Expr> left;
+        Expr* left;
         Token operatorToken;
-        shared_ptr<Expr> right;
+        Expr* right;
     };
 
     class Unary : public Expr {
     public:
-        Unary(Token operatorToken, shared_ptr<Expr> right)
-            : operatorToken(operatorToken), right(right) {}
-
-        string visit(shared_ptr<Visitor> visitor) override {
-            return visitor->visitUnaryExpr(this);
-        }
+        Unary(Token operatorToken, Expr* right)
+            : Expr(ExprKind::UNARY), operatorToken(operatorToken), right(right) {}
 
         Token operatorToken;
-        shared_ptr<Expr> right;
+        Expr* right;
     };
 
     class Literal : public Expr {
     public:
         using LiteralValue = TokenValue;
 
-        Literal(LiteralValue value) : value(value) {}
+        Literal(LiteralValue value) : Expr(ExprKind::LITERAL), value(value) {}
 
-        string visit(shared_ptr<Visitor> visitor) override {
-            return visitor->visitLiteralExpr(this);
+        string toString() const {
+            return toString(value);
         }
 
-        string toString() const {
-            if (std::holds_alternative<string>(value)) {
-                return std::get<string>(value);
-            } else if (std::holds_alternative<double>(value)) {
-                return std::to_string(std::get<double>(value));
+        static string toString(const LiteralValue& value) {
+            if (token::isText(value)) {
+                return string(token::textOf(value));
+            } else if (token::isNumber(value)) {
+                return std::to_string(token::numberOf(value));
             } else if (std::holds_alternative<bool>(value)) {
                 return std::get<bool>(value) ? "true" : "false";
             }
@@ -90,24 +92,95 @@ namespace expr {
 
     class Grouping : public Expr {
     public:
-        Grouping(shared_ptr<Expr> expression) : expression(expression) {}
-
-        string visit(shared_ptr<Visitor> visitor) override {
-            return visitor->visitGroupingExpr(this);
-        }
+        Grouping(Expr* expression) : Expr(ExprKind::GROUPING), expression(expression) {}
 
-        shared_ptr<Expr> expression;
+        Expr* expression;
     };
 
     class Variable : public Expr {
     public:
-        Variable(Token name) : name(name) {}
+        Variable(const Token& token) : Expr(ExprKind::VARIABLE), name(token.symbol()), offset(token.offset) {}
+
+        symbol::Symbol name;
+        uint32_t offset;
+    };
+
+    /**
+     * Appends the Binary nodes down the left edge of `expr`, outermost first,
+     * and returns the node below the last of them.
+     *
+     * Operator chains (1 + 2 + ... + n) parse into left-deep trees as tall as
+     * the chain is long, so the tree walkers loop over this spine instead of
+     * recursing once per operator. What they still recurse into (right
+     * operands, unary operands and groupings) is nested no deeper than
+     * parser::Parser::MAX_DEPTH. Walkers that recurse while working through
+     * a spine can share one vector: each keeps to the entries past the size
+     * it found, and shrinks it back when done.
+     */
+    inline Expr* leftSpine(Binary* expr, std::vector<Binary*>& spine) {
+        Expr* node = expr;
+        while (node->kind == ExprKind::BINARY) {
+            spine.push_back(static_cast<Binary*>(node));
+            node = static_cast<Binary*>(node)->left;
+        }
+        return node;
+    }
+
+    /**
+     * Statically dispatched visitor.
+     *
+     * Derived implements visitBinaryExpr() through visitVariableExpr(), each
+     * returning R (which can be anything: a string, a double, a runtime value
+     * or void). visit() switches on the node's kind tag and calls straight into
+     * Derived, so a walk makes no virtual calls, copies no smart pointers and
+     * allocates nothing on its own.
+     */
+    template <typename Derived, typename R>
+    class Visitor {
+    public:
+        R visit(Expr* expr) {
+            Derived& self = static_cast<Derived&>(*this);
+            switch (expr->kind) {
+                case ExprKind::BINARY: return self.visitBinaryExpr(static_cast<Binary*>(expr));
+                case ExprKind::UNARY: return self.visitUnaryExpr(static_cast<Unary*>(expr));
+                case ExprKind::LITERAL: return self.visitLiteralExpr(static_cast<Literal*>(expr));
+                case ExprKind::GROUPING: return self.visitGroupingExpr(static_cast<Grouping*>(expr));
+                case ExprKind::VARIABLE: return self.visitVariableExpr(static_cast<Variable*>(expr));
+            }
+            std::unreachable();
+        }
+    };
+
+    // Builds pointer-linked nodes in an arena. Along with flat::FlatAst this is
+    // one of the node builders the parser's productions are generic over.
+    class TreeBuilder {
+    public:
+        using Node = Expr*;
+
+        explicit TreeBuilder(AstArena& arena) : arena(arena) {}
+
+        Node binary(Node left, const Token& operatorToken, Node right) {
+            return arena.make<Binary>(left, operatorToken, right);
+        }
+
+        Node unary(const Token& operatorToken, Node right) {
+            return arena.make<Unary>(operatorToken, right);
+        }
+
+        Node grouping(Node expression, const Token&) {
+            return arena.make<Grouping>(expression);
+        }
+
+        Node literal(const TokenValue& value, const Token&) {
+            return arena.make<Literal>(value);
+        }
 
-        string visit(shared_ptr<Visitor> visitor) override {
-            return visitor->visitVariableExpr(this);
+        Node variable(const Token& name) {
+            return arena.make<Variable>(name);
         }
 
-        Token name;
+    private:
+        AstArena& arena;
     };
 } // namespace expr
 
@@ -0,0 +1,130 @@
+#ifndef FLATAST_H
+#define FLATAST_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "Token.h"
+
+using token::Token;
+using token::TokenType;
+using token::TokenValue;
+
+namespace flat {
+
+    enum class NodeKind : uint8_t {
+        BINARY,
+        UNARY,
+        LITERAL,
+        GROUPING,
+        VARIABLE,
+    };
+
+    using NodeId = uint32_t;
+    constexpr NodeId NO_NODE = UINT32_MAX;
+
+    /**
+     * Compact, struct-of-arrays form of the expression tree.
+     *
+     * Every node is a row across the parallel arrays below (14 bytes per node),
+     * children are referred to by index, and literal values live in a separate
+     * constant pool. Nodes are appended in post-order, so a node's children
+     * always come before it and a forward sweep over the arrays visits every
+     * subtree bottom-up without any recursion or pointer chasing. The nodes of
+     * each top-level expression form one contiguous run that ends at its root.
+     *
+     * Operand layout by kind:
+     *   BINARY    lhs = left child, rhs = right child, op = operator
+     *   UNARY     lhs = operand, op = operator
+     *   GROUPING  lhs = inner expression
+     *   LITERAL   lhs = constant index
+     *   VARIABLE  lhs = constant index of the name
+     */
+    class FlatAst {
+    public:
+        // The node builder interface the parser is generic over.
+        using Node = NodeId;
+
+        // Constants shared by every tree: nil, false and true.
+        static constexpr uint32_t NIL_CONSTANT = 0;
+        static constexpr uint32_t FALSE_CONSTANT = 1;
+        static constexpr uint32_t TRUE_CONSTANT = 2;
+
+        FlatAst() { clear(); }
+
+        std::vector<NodeKind> kinds;
+        std::vector<uint8_t> ops;    // TokenType of the operator
+        std::vector<uint32_t> lhs;
+        std::vector<uint32_t> rhs;
+        std::vector<uint32_t> offsets; // source offset of the node's token
+
+        std::vector<TokenValue> constants;
+        std::vector<NodeId> roots;   // one per top-level expression, in source order
+
+        size_t size() const { return kinds.size(); }
+
+        void reserve(size_t nodes) {
+            kinds.reserve(nodes);
+            ops.reserve(nodes);
+            lhs.reserve(nodes);
+            rhs.reserve(nodes);
+            offsets.reserve(nodes);
+        }
+
+        void clear() {
+            kinds.clear();
+            ops.clear();
+            lhs.clear();
+            rhs.clear();
+            offsets.clear();
+            roots.clear();
+            constants.assign({ TokenValue(monostate {}), TokenValue(false), TokenValue(true) });
+        }
+
+        TokenType op(NodeId node) const { return static_cast<TokenType>(ops[node]); }
+
+        // First node of the run that makes up the given root's expression.
+        NodeId firstNodeOf(size_t rootIndex) const { return rootIndex == 0 ? 0 : roots[rootIndex - 1] + 1; }
+
+        Node binary(Node left, const Token& operatorToken, Node right) {
+            return append(NodeKind::BINARY, operatorToken.type, left, right, operatorToken.offset);
+        }
+
+        Node unary(const Token& operatorToken, Node right) {
+            return append(NodeKind::UNARY, operatorToken.type, right, NO_NODE, operatorToken.offset);
+        }
+
+        Node grouping(Node expression, const Token& paren) {
+            return append(NodeKind::GROUPING, TokenType::NONE, expression, NO_NODE, paren.offset);
+        }
+
+        Node literal(const TokenValue& value, const Token& token) {
+            return append(NodeKind::LITERAL, token.type, constant(value), NO_NODE, token.offset);
+        }
+
+        Node variable(const Token& name) {
+            return append(NodeKind::VARIABLE, TokenType::IDENTIFIER, constant(name.lexeme), NO_NODE, name.offset);
+        }
+
+    private:
+        uint32_t constant(const TokenValue& value) {
+            if (std::holds_alternative<monostate>(value)) return NIL_CONSTANT;
+            if (std::holds_alternative<bool>(value)) return std::get<bool>(value) ? TRUE_CONSTANT : FALSE_CONSTANT;
+            constants.push_back(value);
+            return static_cast<uint32_t>(constants.size() - 1);
+        }
+
+        Node append(NodeKind kind, TokenType op, uint32_t a, uint32_t b, uint32_t offset) {
+            kinds.push_back(kind);
+            ops.push_back(static_cast<uint8_t>(op));
+            lhs.push_back(a);
+            rhs.push_back(b);
+            offsets.push_back(offset);
+            return static_cast<NodeId>(kinds.size() - 1);
+        }
+    };
+
+} // namespace flat
+
+#endif /* FLATAST_H */
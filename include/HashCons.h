@@ -0,0 +1,88 @@
+#ifndef HASHCONS_H
+#define HASHCONS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "AstArena.h"
+#include "Expr.h"
+
+namespace expr {
+
+    // Structural hashing and equality. Two trees are equal when they have
+    // the same shape, operators, literal values (of the same kind) and
+    // variable names, wherever in the source they came from. Shared subtrees
+    // compare equal by pointer without being walked, so trees from a
+    // HashConsBuilder compare in O(1). Each distinct node, or pair of
+    // nodes, is hashed or compared once per call however often it is
+    // shared, so both take time linear in the size of the DAG.
+    size_t structuralHash(Expr* expr);
+    bool structurallyEqual(Expr* a, Expr* b);
+
+    /**
+     * Node builder that hash-conses: a node structurally identical to one it
+     * already built is not built again, and the existing node is returned
+     * instead. Because children are shared before their parents are built,
+     * a node is identified by its kind, operator or value, and the addresses
+     * of its children. So every lookup is one hash and one shallow compare,
+     * and the trees of a whole script become a single DAG. The arena must
+     * not be rewound while the builder is in use.
+     *
+     * A shared node keeps the source offsets of its first occurrence, and
+     * runtime errors inside it are reported there. Built nodes must not be
+     * changed, or the table no longer finds them; fold them with a
+     * ConstantFolder in its `shared` mode.
+     */
+    class HashConsBuilder {
+    public:
+        using Node = Expr*;
+
+        explicit HashConsBuilder(AstArena& arena) : arena(arena) {}
+
+        Node binary(Node left, const Token& operatorToken, Node right) {
+            auto mark = arena.mark();
+            return intern(mark, arena.make<Binary>(left, operatorToken, right));
+        }
+
+        Node unary(const Token& operatorToken, Node right) {
+            auto mark = arena.mark();
+            return intern(mark, arena.make<Unary>(operatorToken, right));
+        }
+
+        Node grouping(Node expression, const Token&) {
+            auto mark = arena.mark();
+            return intern(mark, arena.make<Grouping>(expression));
+        }
+
+        Node literal(const TokenValue& value, const Token&) {
+            auto mark = arena.mark();
+            return intern(mark, arena.make<Literal>(value));
+        }
+
+        Node variable(const Token& name) {
+            auto mark = arena.mark();
+            return intern(mark, arena.make<Variable>(name));
+        }
+
+        // Nodes the parser asked for, and how many of them were distinct.
+        size_t built() const { return requested; }
+        size_t unique() const { return count; }
+
+    private:
+        AstArena& arena;
+        // Open addressing with linear probing; a power-of-two number of slots,
+        // at most half full.
+        std::vector<Expr*> slots;
+        size_t count = 0;
+        size_t requested = 0;
+
+        // Returns the existing twin of `candidate`, giving the candidate's
+        // memory back to the arena, or keeps the candidate.
+        Expr* intern(AstArena::Mark mark, Expr* candidate);
+        void grow();
+    };
+
+} // namespace expr
+
+#endif /* HASHCONS_H */
@@ -0,0 +1,58 @@
+#ifndef INTERPRETER_H
+#define INTERPRETER_H
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "Expr.h"
+#include "Value.h"
+
+using expr::Visitor;
+using runtime::Value;
+using std::string;
+using token::Token;
+
+namespace interpreter {
+
+    // Raised for type errors and the like; carries the token to report the line of.
+    class RuntimeError : public std::runtime_error {
+    public:
+        RuntimeError(const Token& token, const string& message) : std::runtime_error(message), token(token) {}
+
+        Token token;
+    };
+
+    /**
+     * Tree-walking evaluator over expr nodes.
+     *
+     * Results are NaN-boxed runtime::Values, so evaluating arithmetic never
+     * allocates; only string concatenation touches the heap.
+     */
+    class Interpreter : public Visitor<Interpreter, Value> {
+    public:
+        explicit Interpreter(runtime::Heap& heap) : heap(heap) {}
+
+        // Throws RuntimeError when the expression cannot be evaluated.
+        Value evaluate(expr::Expr* expr) {
+            spine.clear(); // whatever an error left behind
+            return visit(expr);
+        }
+
+        Value visitBinaryExpr(expr::Binary* expr);
+        Value visitUnaryExpr(expr::Unary* expr);
+        Value visitLiteralExpr(expr::Literal* expr);
+        Value visitGroupingExpr(expr::Grouping* expr);
+        Value visitVariableExpr(expr::Variable* expr);
+
+    private:
+        runtime::Heap& heap;
+        std::vector<expr::Binary*> spine; // see expr::leftSpine()
+
+        // Evaluates the right operand and applies the operator.
+        Value binary(expr::Binary* expr, Value left);
+    };
+
+} // namespace interpreter
+
+#endif /* INTERPRETER_H */
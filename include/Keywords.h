@@ -0,0 +1,121 @@
+#ifndef KEYWORDS_H
+#define KEYWORDS_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+#include "Token.h"
+
+using std::string_view;
+using token::TokenType;
+
+namespace scanner {
+
+    struct Keyword {
+        string_view spelling;
+        TokenType type;
+    };
+
+    // The one list of reserved words. Adding a keyword is a line here (plus its
+    // TokenType); the lookup table below is regenerated by the compiler.
+    inline constexpr Keyword keywordList[] = {
+        {"and", TokenType::AND},
+        {"class", TokenType::CLASS},
+        {"else", TokenType::ELSE},
+        {"false", TokenType::FALSE},
+        {"fun", TokenType::FUN},
+        {"for", TokenType::FOR},
+        {"if", TokenType::IF},
+        {"nil", TokenType::NIL},
+        {"or", TokenType::OR},
+        {"print", TokenType::PRINT},
+        {"return", TokenType::RETURN},
+        {"super", TokenType::SUPER},
+        {"this", TokenType::THIS},
+        {"true", TokenType::TRUE},
+        {"var", TokenType::VAR},
+        {"while", TokenType::WHILE},
+    };
+
+    // The spelling of a keyword token type; empty for other types.
+    constexpr string_view keywordSpelling(TokenType type) {
+        for (const Keyword& keyword : keywordList) {
+            if (keyword.type == type) return keyword.spelling;
+        }
+        return string_view();
+    }
+
+    namespace keywords {
+
+        constexpr size_t TABLE_SIZE = 64; // power of two, comfortably above the keyword count
+
+        constexpr size_t minLength() {
+            size_t length = SIZE_MAX;
+            for (const Keyword& keyword : keywordList) length = keyword.spelling.size() < length ? keyword.spelling.size() : length;
+            return length;
+        }
+
+        constexpr size_t maxLength() {
+            size_t length = 0;
+            for (const Keyword& keyword : keywordList) length = keyword.spelling.size() > length ? keyword.spelling.size() : length;
+            return length;
+        }
+
+        // Only looks at the length and the first and last characters, so hashing
+        // costs the same for every identifier regardless of its length.
+        constexpr uint32_t hash(string_view word, uint32_t seed) {
+            uint32_t key = static_cast<uint8_t>(word.front())
+                | static_cast<uint32_t>(static_cast<uint8_t>(word.back())) << 8
+                | static_cast<uint32_t>(word.size()) << 16;
+            return ((key * seed) >> 20) & (TABLE_SIZE - 1);
+        }
+
+        constexpr bool isCollisionFree(uint32_t seed) {
+            std::array<bool, TABLE_SIZE> used {};
+            for (const Keyword& keyword : keywordList) {
+                uint32_t slot = hash(keyword.spelling, seed);
+                if (used[slot]) return false;
+                used[slot] = true;
+            }
+            return true;
+        }
+
+        constexpr uint32_t findSeed() {
+            for (uint32_t seed = 1; seed < 1'000'000; seed += 2) {
+                if (isCollisionFree(seed)) return seed;
+            }
+            return 0;
+        }
+
+        inline constexpr uint32_t SEED = findSeed();
+        static_assert(SEED != 0, "no perfect hash seed for the keyword list; grow TABLE_SIZE");
+
+        constexpr std::array<Keyword, TABLE_SIZE> buildTable() {
+            std::array<Keyword, TABLE_SIZE> table {};
+            for (const Keyword& keyword : keywordList) table[hash(keyword.spelling, SEED)] = keyword;
+            return table;
+        }
+
+        inline constexpr std::array<Keyword, TABLE_SIZE> table = buildTable();
+
+    } // namespace keywords
+
+    /**
+     * Classifies an identifier lexeme as a keyword or a plain IDENTIFIER.
+     * One hash, one probe and one compare; nothing is allocated.
+     */
+    constexpr TokenType lookupKeyword(string_view word) {
+        if (word.size() < keywords::minLength() || word.size() > keywords::maxLength()) return TokenType::IDENTIFIER;
+        const Keyword& candidate = keywords::table[keywords::hash(word, keywords::SEED)];
+        return candidate.spelling == word ? candidate.type : TokenType::IDENTIFIER;
+    }
+
+    static_assert(lookupKeyword("while") == TokenType::WHILE);
+    static_assert(lookupKeyword("orchard") == TokenType::IDENTIFIER);
+    static_assert(lookupKeyword("fo") == TokenType::IDENTIFIER);
+
+} // namespace scanner
+
+#endif /* KEYWORDS_H */
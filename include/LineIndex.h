@@ -0,0 +1,54 @@
+#ifndef LINEINDEX_H
+#define LINEINDEX_H
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string_view>
+#include <vector>
+
+using std::string_view;
+
+namespace source {
+
+    // 1-based line and column; the column counts bytes.
+    struct Position {
+        int line;
+        int column;
+    };
+
+    // Writes "line 3, column 7", the way every diagnostic spells a position.
+    inline std::ostream& operator<<(std::ostream& out, Position position) {
+        return out << "line " << position.line << ", column " << position.column;
+    }
+
+    /**
+     * Maps byte offsets of a source to lines and columns.
+     *
+     * Tokens and nodes only record offsets, so nothing is spent on lines
+     * while scanning. The table of line starts is built on the first lookup,
+     * in one vectorized pass over the source, and most scripts that run
+     * cleanly never build it. Lookups are a binary search, except that one
+     * at or just after the previous lookup's line is answered directly, so a
+     * front-to-back token dump costs O(1) per token. The text must outlive
+     * the index and be at most source::MAX_SOURCE_SIZE bytes, as every
+     * offset is. Lookups are not thread-safe.
+     */
+    class LineIndex {
+    public:
+        explicit LineIndex(string_view text) : text(text) {}
+
+        Position position(uint32_t offset) const;
+        int line(uint32_t offset) const { return position(offset).line; }
+
+    private:
+        string_view text;
+        mutable std::vector<uint32_t> starts; // offset of each line's first byte
+        mutable size_t recent = 0;            // line (0-based) of the last lookup
+
+        void build() const;
+    };
+
+} // namespace source
+
+#endif /* LINEINDEX_H */
@@ -0,0 +1,112 @@
+#ifndef OUTPUTSINK_H
+#define OUTPUTSINK_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <ostream>
+#include <streambuf>
+#include <string>
+#include <string_view>
+
+using std::string;
+using std::string_view;
+
+namespace output {
+
+    /**
+     * Append-only output buffer that is written out in large blocks.
+     *
+     * Everything the token dump and the AST printers produce is appended to one
+     * growable buffer, which goes to the underlying FILE only once it passes
+     * FLUSH_THRESHOLD (and on flush() / destruction), instead of once per line.
+     * A sink created without a FILE just collects the text, e.g. to keep the
+     * output of one script together.
+     */
+    class OutputSink {
+    public:
+        static constexpr size_t FLUSH_THRESHOLD = 256 * 1024;
+
+        explicit OutputSink(FILE* file = nullptr) : file(file) {}
+        ~OutputSink() { flush(); }
+
+        OutputSink(const OutputSink&) = delete;
+        OutputSink& operator=(const OutputSink&) = delete;
+
+        OutputSink& operator<<(string_view text) {
+            buffer.append(text);
+            maybeFlush();
+            return *this;
+        }
+
+        OutputSink& operator<<(char c) {
+            buffer.push_back(c);
+            maybeFlush();
+            return *this;
+        }
+
+        OutputSink& operator<<(int64_t number);
+        OutputSink& operator<<(int number) { return *this << static_cast<int64_t>(number); }
+        OutputSink& operator<<(size_t number);
+        OutputSink& operator<<(unsigned number) { return *this << static_cast<size_t>(number); }
+
+        // The same text std::to_string(double) produces ("%f").
+        OutputSink& fixed(double number);
+        // The same text `std::cout << number` produces (six significant digits).
+        OutputSink& general(double number);
+        // The shortest text that reads back as the same double; used for JSON.
+        OutputSink& shortest(double number);
+        // A double-quoted JSON string with the necessary escapes.
+        OutputSink& jsonString(string_view text);
+
+        void flush();
+
+        // Text that has not been flushed yet; for a sink without a FILE, all of it.
+        string_view buffered() const { return buffer; }
+        string take() { return std::move(buffer); }
+
+    private:
+        FILE* file;
+        string buffer;
+
+        void maybeFlush() {
+            if (file != nullptr && buffer.size() >= FLUSH_THRESHOLD) flush();
+        }
+    };
+
+    /**
+     * A std::ostream that writes into an OutputSink, for code that reports
+     * through an ostream (the scanner's lexical errors). The text joins the
+     * sink's buffer, so it comes out exactly where it was written relative to
+     * the dump and the printed trees. std::endl does not flush the sink.
+     */
+    class SinkStream : public std::ostream {
+    public:
+        explicit SinkStream(OutputSink& sink) : std::ostream(&adapter), adapter(sink) {}
+
+    private:
+        class Adapter : public std::streambuf {
+        public:
+            explicit Adapter(OutputSink& sink) : sink(sink) {}
+
+        protected:
+            int_type overflow(int_type c) override {
+                if (!traits_type::eq_int_type(c, traits_type::eof())) sink << traits_type::to_char_type(c);
+                return traits_type::not_eof(c);
+            }
+
+            std::streamsize xsputn(const char* text, std::streamsize count) override {
+                sink << string_view(text, static_cast<size_t>(count));
+                return count;
+            }
+
+        private:
+            OutputSink& sink;
+        };
+
+        Adapter adapter;
+    };
+
+} // namespace output
+
+#endif /* OUTPUTSINK_H */
@@ -0,0 +1,42 @@
+#ifndef PARALLELSCANNER_H
+#define PARALLELSCANNER_H
+
+#include <cstddef>
+#include <ostream>
+#include <string_view>
+#include <vector>
+
+#include "Token.h"
+#include "ThreadPool.h"
+
+using std::string_view;
+using token::Token;
+
+namespace scanner {
+
+    /**
+     * Lexes one large source on several threads and returns the same tokens,
+     * with the same offsets, as a single Scanner would (END_OF_FILE
+     * included).
+     *
+     * The buffer is cut at line starts. Whether a cut lands inside a string
+     * literal depends on everything before it, so a first parallel pass runs
+     * a small quote/comment automaton over each chunk twice: once assuming
+     * the chunk starts outside a string and once assuming it starts inside
+     * one. A sequential walk over these summaries then picks the real state
+     * at every cut. A cut that falls inside a string moves to the first line
+     * start after the string closes, or is dropped if the string runs to the
+     * end of the chunk. The pieces are then lexed in parallel by ordinary
+     * Scanners started at the piece's offset and stitched together.
+     *
+     * Lexical errors are written to `diagnostics` in source order once every
+     * piece is done. The pool must not be running tasks that wait on it.
+     */
+    std::vector<Token> scanParallel(string_view source, concurrency::ThreadPool& pool, std::ostream& diagnostics);
+
+    // Sources below this size are not worth splitting and are lexed on the calling thread.
+    inline constexpr size_t MIN_PARALLEL_CHUNK = 256 * 1024;
+
+} // namespace scanner
+
+#endif /* PARALLELSCANNER_H */
@@ -1,40 +1,122 @@
 #ifndef PARSER_H
 #define PARSER_H
 
+#include <array>
+#include <memory>
+#include <stdexcept>
+#include <string>
 #include <vector>
+#include "Diagnostics.h"
 #include "Scanner.h"
+#include "TokenSource.h"
 #include "Expr.h"
+#include "FlatAst.h"
+#include "HashCons.h"
 
 using token::Token;
 using expr::Expr;
 
 namespace parser {
 
+    // Raised for syntax errors; carries the token the parser stopped at. A
+    // parser that threw one from next() is left unusable, but nothing outside
+    // it is affected, so callers can report the error and carry on with other
+    // work. next(Diagnostics&) catches it and recovers instead.
+    class ParseError : public std::runtime_error {
+    public:
+        ParseError(const Token& token, const std::string& message) : std::runtime_error(message), token(token) {}
+
+        Token token;
+    };
+
+    // How tightly an infix operator binds, loosest first.
+    enum class Precedence : uint8_t {
+        NONE,       // not an infix operator
+        EQUALITY,   // == !=
+        COMPARISON, // > >= < <=
+        TERM,       // - +
+        FACTOR,     // / *
+        UNARY,      // ! - (prefix)
+    };
+
     class Parser {
     public:
-        Parser(const std::vector<Token>& tokens);
+        // The deepest nesting of parentheses, unary operators and right
+        // operands the parser accepts. The parser and every tree walker
+        // recurse once per level of it, so deeper input is reported as a
+        // syntax error instead of overflowing the stack of whatever thread
+        // runs it. Operator chains such as 1 + 2 + ... + n are not nested:
+        // the parser builds them in a loop and the walkers follow their left
+        // spines in a loop too (see expr::leftSpine()), so they may be of any
+        // length.
+        static constexpr uint32_t MAX_DEPTH = 2048;
+
+        // Nodes are allocated from the arena, which must outlive the trees built from it.
+        Parser(const std::vector<Token>& tokens, expr::AstArena& arena);
+        // Streaming mode: tokens are lexed only as the parser asks for them.
+        Parser(scanner::Scanner& scanner, expr::AstArena& arena);
+        // `text` is the source the tokens came from, if the caller has it; it
+        // lets synchronize() recover at line breaks.
+        Parser(TokenSource& source, expr::AstArena& arena, string_view text = string_view());
         ~Parser();
 
-        void parse();
+        // Parses the next top-level expression, or returns nullptr at the end of
+        // the input. Callers that are done with a tree can rewind the arena to a
+        // mark taken before the call, which keeps memory bounded by the largest
+        // single expression.
+        Expr* next();
+        // Like next(), but instead of throwing, a syntax error is added to
+        // `errors` and the parser recovers with synchronize() and goes on to
+        // the expression after it. Returns nullptr only at the end.
+        Expr* next(diagnostics::Diagnostics& errors);
+        // Like next(), but builds with `builder`, so identical subtrees are
+        // shared with everything the builder built before.
+        Expr* next(expr::HashConsBuilder& builder);
+        // Parses every remaining expression into the flat layout, one root each.
+        void parse(flat::FlatAst& ast);
+        // Tokens consumed so far, not counting the one token of lookahead.
+        size_t consumed() const { return current; }
 
     private:
-        const std::vector<Token>& tokens;
-        size_t current;
+        // previous() and peek() are the only lookahead the grammar needs, so a
+        // handful of slots is enough no matter how long the script is.
+        static constexpr size_t WINDOW_SIZE = 4;
+
+        std::unique_ptr<TokenSource> ownedSource;
+        TokenSource* tokens;
+        expr::AstArena& arena;
+        string_view text;
+        std::array<Token, WINDOW_SIZE> window;
+        size_t current; // number of tokens consumed
+        size_t fetched; // number of tokens pulled from the source
+        uint32_t depth = 0; // parsePrecedence() calls in progress
+
+        const Token& slot(size_t index) const { return window[index % WINDOW_SIZE]; }
 
         bool isAtEnd();
         const Token& advance();
         const Token& peek();
         const Token& previous();
-        template <typename... Type>
-        bool match(Type... types);
         bool match(TokenType type);
-        shared_ptr<Expr> primary();
-        shared_ptr<Expr> unary();
-        shared_ptr<Expr> factor();
-        shared_ptr<Expr> term();
-        shared_ptr<Expr> comparison();
-        shared_ptr<Expr> equality();
-        shared_ptr<Expr> expression();
+        // Expressions are parsed Pratt style: every token type has a Rule in
+        // the `rules` table (Parser.cpp) saying how it starts an expression,
+        // how it continues one and how tightly it binds. The handlers are
+        // generic over the node builder, so the same grammar code emits either
+        // arena trees (expr::TreeBuilder) or flat::FlatAst rows.
+        template <typename Builder> struct Rule;
+        template <typename Builder> static const Rule<Builder> rules[];
+        template <typename Builder> typename Builder::Node expression(Builder& builder);
+        // Parses operators that bind at least as tightly as `precedence`.
+        template <typename Builder> typename Builder::Node parsePrecedence(Builder& builder, Precedence precedence);
+        // Prefix handlers; the token they start with is previous().
+        template <typename Builder> typename Builder::Node literal(Builder& builder);
+        template <typename Builder> typename Builder::Node grouping(Builder& builder);
+        template <typename Builder> typename Builder::Node unary(Builder& builder);
+        // Infix handlers; the operator is previous().
+        template <typename Builder> typename Builder::Node binary(Builder& builder, typename Builder::Node left);
+        bool startsLine(const Token& token);
+        // Panic mode: skips the token in error and everything up to where a
+        // new expression is likely to start.
         void synchronize();
         // Add more parsing functions as needed
     };
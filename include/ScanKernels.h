@@ -0,0 +1,44 @@
+#ifndef SCANKERNELS_H
+#define SCANKERNELS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace scanner::kernels {
+
+    // Instruction set the kernels below were dispatched to.
+    enum class Level {
+        SCALAR,
+        SSE2,
+        AVX2,
+    };
+
+    /**
+     * The best level the running CPU supports. Detected once, on first use;
+     * setting MAC_SIMD=scalar|sse2|avx2 in the environment caps it, which is
+     * handy for comparing the implementations against each other.
+     */
+    Level activeLevel();
+    const char* levelName(Level level);
+
+    // Each kernel scans [begin, end) and returns a pointer to the first byte
+    // that ends the run, or end when the run reaches the end of the buffer.
+
+    // Skips ' ', '\t', '\r' and '\n'.
+    const char* skipBlanks(const char* begin, const char* end);
+    // Finds the '\n' that terminates a "//" comment.
+    const char* findLineEnd(const char* begin, const char* end);
+    // Finds the next '"' or '\\' in a string literal body.
+    const char* findStringDelimiter(const char* begin, const char* end);
+    // Skips [A-Za-z0-9_].
+    const char* skipIdentifier(const char* begin, const char* end);
+    // Skips [0-9].
+    const char* skipDigits(const char* begin, const char* end);
+
+    // Not a run: appends the offset from begin of every '\n' in [begin, end).
+    void findNewlines(const char* begin, const char* end, std::vector<uint32_t>& offsets);
+
+} // namespace scanner::kernels
+
+#endif /* SCANKERNELS_H */
@@ -3,16 +3,23 @@
 
 #include <cstddef>
 #include <iostream> // for cout
+#include <ostream>
 #include <iterator> // for std::forward_iterator_tag
 #include <string>
-#include <unordered_map>
+#include <string_view>
 
+#include "CharClass.h"
+#include "Diagnostics.h"
+#include "Keywords.h"
+#include "LineIndex.h"
 #include "Token.h"
 
 using std::cout;
 using std::string;
+using std::string_view;
 using token::Token;
 using token::TokenType;
+using token::TokenValue;
 
 namespace scanner {
 
@@ -66,47 +73,48 @@ namespace scanner {
             Iterator end() {
                 return Iterator(this, true);
             }
-            Scanner(const string& source): source(source) {}
+            /**
+             * The scanner does not copy the source: apart from identifiers and
+             * string literals, which are interned symbols, tokens refer back
+             * into this buffer, so the caller has to keep it alive for as long
+             * as the tokens are in use.
+             */
+            Scanner(string_view source): source(source), diagnostics(&cout) {}
+            // Lexical errors are written to `diagnostics` instead of cout.
+            // Scanning can start part way into the source (`from`), so that
+            // offsets of a slice are still offsets into the whole buffer.
+            Scanner(string_view source, std::ostream& diagnostics, size_t from = 0)
+                : source(source), diagnostics(&diagnostics), current(from) {}
+            // Lexical errors are collected instead of written anywhere.
+            Scanner(string_view source, diagnostics::Diagnostics& collected, size_t from = 0)
+                : source(source), collected(&collected), current(from) {}
             Scanner() = delete;
 
+            string_view text() const { return source; }
+
         private:
-            string source;
-            int start = 0;
-            int current = 0;
-            int line = 1;
-
-            std::unordered_map<string, TokenType> keywords = {
-                {"and", TokenType::AND},
-                {"class", TokenType::CLASS},
-                {"else", TokenType::ELSE},
-                {"false", TokenType::FALSE},
-                {"fun", TokenType::FUN},
-                {"for", TokenType::FOR},
-                {"if", TokenType::IF},
-                {"nil", TokenType::NIL},
-                {"or", TokenType::OR},
-                {"print", TokenType::PRINT},
-                {"return", TokenType::RETURN},
-                {"super", TokenType::SUPER},
-                {"this", TokenType::THIS},
-                {"true", TokenType::TRUE},
-                {"var", TokenType::VAR},
-                {"while", TokenType::WHILE},
-            };
+            string_view source;
+            std::ostream* diagnostics = nullptr;
+            diagnostics::Diagnostics* collected = nullptr;
+            // Only consulted to report errors with their line.
+            source::LineIndex lines { source };
+            size_t start = 0;
+            size_t current = 0;
 
             /**
              * Scans the next char from the source string.
              * And advances the pointer to the next character.
+             * Callers check isAtEnd() first, so no bounds check is done here.
              *
              * @return The scanned char.
              */
             char advance() {
-                return source.at(current++);
+                return source[current++];
             }
 
             bool match(char expected) {
                 if (isAtEnd()) return false;
-                if (source.at(current) != expected) return false;
+                if (source[current] != expected) return false;
                 current++;
                 return true;
             }
@@ -117,32 +125,56 @@ namespace scanner {
 
             char peek() {
                 if (isAtEnd()) return '\0';
-                return source.at(current);
+                return source[current];
             }
 
             char peekNext() {
                 if (current + 1 >= source.length()) return '\0';
-                return source.at(current + 1);
+                return source[current + 1];
             }
 
             bool isWhitespace(char c) {
-                return c == ' ' || c == '\r' || c == '\t';
+                return charClass(c) & CC_SPACE;
             }
 
             bool isDigit(char c) {
-                return c >= '0' && c <= '9';
+                return charClass(c) & CC_DIGIT;
             }
 
             bool isAlpha(char c) {
-                return (c >= 'a' && c <= 'z') ||
-                       (c >= 'A' && c <= 'Z') ||
-                       c == '_';
+                return charClass(c) & CC_ALPHA;
             }
 
             bool isAlphaNumeric(char c) {
-                return isAlpha(c) || isDigit(c);
+                return charClass(c) & CC_IDENTIFIER;
             }
+
+            // Pointer-based views of the cursor for the vectorized kernels.
+            const char* cursor() const { return source.data() + current; }
+            const char* sourceEnd() const { return source.data() + source.length(); }
+            void moveTo(const char* position) { current = position - source.data(); }
+
+            void reportError(const char* message) {
+                if (collected != nullptr) {
+                    collected->report(diagnostics::Stage::LEXICAL, static_cast<uint32_t>(start), message);
+                } else {
+                    *diagnostics << message << " on " << lines.position(static_cast<uint32_t>(start)) << std::endl;
+                }
+            }
+
+            Token makeToken(TokenType type, TokenValue lexeme) {
+                return Token(type, lexeme, static_cast<uint32_t>(start), static_cast<uint32_t>(current - start));
+            }
+
+            Token makeToken(TokenType type) {
+                return makeToken(type, TokenValue(source.substr(start, current - start)));
+            }
+
             Token scanToken();
+            Token identifier();
+            Token number();
+            Token stringLiteral();
+            string unescape(string_view body);
     };
 }
 
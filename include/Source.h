@@ -0,0 +1,62 @@
+#ifndef SOURCE_H
+#define SOURCE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+using std::string;
+using std::string_view;
+
+namespace source {
+
+    // Tokens, nodes and the LineIndex keep 32-bit offsets, END_OF_FILE's
+    // included, so no script may be longer than this.
+    inline constexpr size_t MAX_SOURCE_SIZE = UINT32_MAX;
+
+    /**
+     * Read-only view of a script on disk.
+     *
+     * Regular files are memory-mapped, so loading a script costs a single
+     * page-cache mapping and no heap copy. Anything that cannot be mapped
+     * (pipes, character devices, empty files) is read with as few read()
+     * calls as possible into a buffer sized from fstat() when the size is known.
+     * The view stays valid for the lifetime of the SourceFile.
+     *
+     * A file longer than `limit` is not opened, and isTooLarge() says so.
+     * Scripts keep the default; other files (such as the AST cache's) may
+     * lift it.
+     */
+    class SourceFile {
+    public:
+        explicit SourceFile(const char* path, size_t limit = MAX_SOURCE_SIZE);
+        ~SourceFile();
+
+        SourceFile(const SourceFile&) = delete;
+        SourceFile& operator=(const SourceFile&) = delete;
+        SourceFile(SourceFile&& other) noexcept;
+        SourceFile& operator=(SourceFile&& other) noexcept;
+
+        bool isOpen() const { return opened; }
+        bool isTooLarge() const { return tooLarge; }
+        bool isMapped() const { return mapped; }
+        size_t size() const { return length; }
+        string_view view() const { return string_view(data, length); }
+
+    private:
+        const char* data = nullptr;
+        size_t length = 0;
+        bool opened = false;
+        bool mapped = false;
+        bool tooLarge = false;
+        // Backing storage when the file could not be mapped.
+        string buffer;
+
+        bool readAll(int fd, size_t sizeHint, size_t limit);
+        void release();
+    };
+
+} // namespace source
+
+#endif /* SOURCE_H */
@@ -0,0 +1,73 @@
+#ifndef SPSCRING_H
+#define SPSCRING_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+namespace concurrency {
+
+    /**
+     * Bounded ring between exactly one producer thread and one consumer
+     * thread, with no locks.
+     *
+     * Slots are filled and read in place: the producer claim()s the next
+     * free slot, fills it and publish()es it, and the consumer reads front()
+     * and pop()s it, so nothing is copied through the ring. Each side owns
+     * one index and only reads the other's. A full ring holds the producer
+     * back and an empty one holds the consumer; a waiting side spins briefly
+     * and then sleeps on the other side's index.
+     */
+    template <typename T, size_t Capacity>
+    class SpscRing {
+        static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "capacity must be a power of two");
+
+    public:
+        // Producer: the next free slot, waiting while the ring is full.
+        T& claim() {
+            size_t tail = this->tail.load(std::memory_order_relaxed);
+            awaitChange(head, [&](size_t head) { return tail - head < Capacity; });
+            return slots[tail & (Capacity - 1)];
+        }
+
+        // Producer: hands the claimed slot over to the consumer.
+        void publish() {
+            tail.store(tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+            tail.notify_one();
+        }
+
+        // Consumer: the oldest published slot, waiting while the ring is empty.
+        T& front() {
+            size_t head = this->head.load(std::memory_order_relaxed);
+            awaitChange(tail, [&](size_t tail) { return tail != head; });
+            return slots[head & (Capacity - 1)];
+        }
+
+        // Consumer: gives the front slot back to the producer.
+        void pop() {
+            head.store(head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+            head.notify_one();
+        }
+
+    private:
+        static constexpr int SPINS = 256;
+
+        // The indices sit on cache lines of their own so the two threads do
+        // not keep stealing each other's line.
+        alignas(64) std::atomic<size_t> head { 0 }; // next slot to read
+        alignas(64) std::atomic<size_t> tail { 0 }; // next slot to fill
+        alignas(64) std::array<T, Capacity> slots;
+
+        template <typename Ready>
+        static void awaitChange(const std::atomic<size_t>& index, Ready ready) {
+            size_t value = index.load(std::memory_order_acquire);
+            for (int spin = 0; !ready(value); spin++) {
+                if (spin >= SPINS) index.wait(value, std::memory_order_acquire);
+                value = index.load(std::memory_order_acquire);
+            }
+        }
+    };
+
+} // namespace concurrency
+
+#endif /* SPSCRING_H */
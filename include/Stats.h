@@ -0,0 +1,219 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "Expr.h"
+#include "TokenSource.h"
+
+using std::string;
+using std::string_view;
+
+namespace stats {
+
+    using Clock = std::chrono::steady_clock;
+
+    // The stages a script goes through, in order.
+    enum class Phase {
+        LOAD,  // opening and mapping the file
+        LEX,   // the scanner
+        PARSE, // the parser (or a cache lookup that replaces it)
+        PRINT, // printing trees, folding included
+        EVAL,  // evaluating or compiling and running, folding included
+    };
+
+    inline constexpr size_t PHASE_COUNT = 5;
+
+    const char* phaseName(Phase phase);
+
+    // Allocations made through the global operator new and new[]. Programs
+    // that want them counted link src/AllocHook.cpp (mac and mac_bench do),
+    // which replaces the allocation functions to count into the current
+    // thread's Account; libmac alone counts nothing. The flag keeps that hook
+    // to one relaxed load while nothing is being measured.
+    inline std::atomic<bool> trackingAllocations { false };
+
+    struct Allocations {
+        uint64_t count = 0;
+        uint64_t bytes = 0;
+    };
+
+    // Running allocation totals. Each thread has one of its own, which helper
+    // threads may add to as well (see Charge).
+    class Account {
+    public:
+        void note(size_t bytes) {
+            count.fetch_add(1, std::memory_order_relaxed);
+            this->bytes.fetch_add(bytes, std::memory_order_relaxed);
+        }
+
+        Allocations read() const {
+            return Allocations { count.load(std::memory_order_relaxed), bytes.load(std::memory_order_relaxed) };
+        }
+
+    private:
+        std::atomic<uint64_t> count { 0 };
+        std::atomic<uint64_t> bytes { 0 };
+    };
+
+    // The account this thread's allocations go to.
+    Account& currentAccount();
+
+    /**
+     * Sends this thread's allocations to another thread's account while in
+     * scope. Helper threads (the --pipeline scanner, the --parallel-lex
+     * workers) charge the thread they work for, so their allocations count
+     * towards its script. The account must outlive the Charge.
+     */
+    class Charge {
+    public:
+        explicit Charge(Account& account);
+        ~Charge();
+
+        Charge(const Charge&) = delete;
+        Charge& operator=(const Charge&) = delete;
+
+    private:
+        Account* previous;
+    };
+
+    // Largest resident set size of the process so far, in bytes.
+    size_t peakRss();
+
+    struct PhaseStats {
+        bool ran = false;
+        double seconds = 0;
+        uint64_t tokens = 0;
+        uint64_t nodes = 0;
+        uint64_t allocations = 0;
+        uint64_t allocatedBytes = 0;
+        size_t peakRss = 0; // of the whole process, when an outer scope of the phase (or around it) last ended
+    };
+
+    /**
+     * Chrome trace events ("ph":"X" complete events), collected from any
+     * thread and written out as one JSON file that chrome://tracing and
+     * Perfetto open.
+     */
+    class Trace {
+    public:
+        explicit Trace(string path) : path(std::move(path)), origin(Clock::now()) {}
+
+        void event(string_view name, string_view script, Clock::time_point start, Clock::time_point end);
+        // False if the file could not be written.
+        bool write() const;
+
+    private:
+        struct Event {
+            string name;
+            string script;
+            int64_t start; // microseconds since the trace began
+            int64_t duration;
+            uint32_t thread;
+        };
+
+        string path;
+        Clock::time_point origin;
+        mutable std::mutex lock;
+        std::vector<Event> events;
+    };
+
+    /**
+     * Per-phase totals for one script.
+     *
+     * Phases nest: time and allocations of an inner Scope (a parse inside
+     * the print loop, a token pulled inside a parse) count towards the inner
+     * phase only, so the phases add up to the whole run. Allocations are
+     * those charged to the account of the thread the Scope runs on; a helper
+     * thread's count towards whichever phase is open when they happen. Not
+     * thread-safe; one recorder per script.
+     */
+    class Recorder {
+    public:
+        Recorder(string script = string(), Trace* trace = nullptr) : script(std::move(script)), trace(trace) {}
+
+        PhaseStats& operator[](Phase phase) { return phases[static_cast<size_t>(phase)]; }
+        const PhaseStats& operator[](Phase phase) const { return phases[static_cast<size_t>(phase)]; }
+
+        // A table, or with `json` a single JSON line.
+        void print(std::ostream& out, bool json) const;
+
+    private:
+        friend class Scope;
+
+        std::array<PhaseStats, PHASE_COUNT> phases;
+        string script;
+        Trace* trace;
+        // Everything already attributed to some phase; a Scope subtracts what
+        // was attributed while it was open.
+        double attributedSeconds = 0;
+        Allocations attributed;
+        unsigned touched = 0; // phases that ran inside the current outer Scope, one bit each
+    };
+
+    /**
+     * Measures a phase while in scope. With a null recorder it does nothing
+     * beyond a pointer test, which is all instrumentation costs when --stats
+     * is off. Outer scopes (the default) also sample the peak RSS, for their
+     * phase and every phase nested in them, and become trace events; the
+     * many short scopes of a streaming loop do neither.
+     */
+    class Scope {
+    public:
+        Scope(Recorder* recorder, Phase phase, bool outer = true) : recorder(recorder) {
+            if (recorder != nullptr) begin(phase, outer);
+        }
+        ~Scope() {
+            if (recorder != nullptr) end();
+        }
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        Recorder* recorder;
+        Phase phase = Phase::LOAD;
+        bool outer = false;
+        unsigned touched = 0; // the recorder's bits from before this outer scope
+        Clock::time_point start;
+        double attributedSeconds = 0;
+        Allocations allocations;
+        Allocations attributed;
+
+        void begin(Phase phase, bool outer);
+        void end();
+    };
+
+    // Times every token a parser pulls from `source` as LEX, and counts them
+    // (END_OF_FILE aside).
+    class TimedTokens : public parser::TokenSource {
+    public:
+        TimedTokens(parser::TokenSource& source, Recorder& recorder) : source(source), recorder(recorder) {}
+
+        Token next() override {
+            Scope scope(&recorder, Phase::LEX, false);
+            Token token = source.next();
+            if (token.type != TokenType::END_OF_FILE) recorder[Phase::LEX].tokens++;
+            return token;
+        }
+
+    private:
+        parser::TokenSource& source;
+        Recorder& recorder;
+    };
+
+    // Nodes in the tree, counted only when stats are on.
+    size_t countNodes(expr::Expr* root);
+
+} // namespace stats
+
+#endif /* STATS_H */
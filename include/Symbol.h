@@ -0,0 +1,112 @@
+#ifndef SYMBOL_H
+#define SYMBOL_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string_view>
+#include <unordered_map>
+
+#include "AstArena.h"
+
+using std::string_view;
+
+namespace symbol {
+
+    /**
+     * Handle to an interned string: a 32-bit id plus the canonical bytes.
+     *
+     * Every occurrence of the same text interns to the same Symbol, so two
+     * symbols of one table are equal exactly when their ids are. The bytes
+     * never move and stay valid until the table is cleared or destroyed;
+     * symbols of different tables must not be compared.
+     */
+    class Symbol {
+    public:
+        uint32_t id() const { return symbolId; }
+        string_view view() const { return string_view(chars, length); }
+        size_t size() const { return length; }
+
+        friend bool operator==(Symbol a, Symbol b) { return a.symbolId == b.symbolId; }
+        friend bool operator!=(Symbol a, Symbol b) { return a.symbolId != b.symbolId; }
+
+    private:
+        friend class SymbolTable;
+
+        Symbol(uint32_t id, uint32_t length, const char* chars) : symbolId(id), length(length), chars(chars) {}
+
+        uint32_t symbolId;
+        uint32_t length;
+        const char* chars;
+    };
+
+    static_assert(sizeof(Symbol) == 16);
+
+    /**
+     * Thread-safe intern table. It is split into shards by hash, each with its
+     * own lock, map and byte arena, so threads interning different names
+     * rarely wait on each other. The shard number is kept in the low bits of
+     * the id, which keeps ids unique across shards.
+     *
+     * A table only grows until it is cleared, and clearing it invalidates
+     * every symbol it handed out. The process-wide table() is never cleared,
+     * which suits a program that runs scripts and exits. A long-running
+     * embedder should give each session its own table instead (see Scope);
+     * engine::Engine does, and clears it on every call.
+     */
+    class SymbolTable {
+    public:
+        SymbolTable() = default;
+        SymbolTable(const SymbolTable&) = delete;
+        SymbolTable& operator=(const SymbolTable&) = delete;
+
+        Symbol intern(string_view text);
+        // Forgets every symbol, keeping the memory for the next ones.
+        void clear();
+
+        // Number of distinct symbols and the bytes their text takes up.
+        size_t size();
+        size_t bytes();
+
+    private:
+        static constexpr unsigned SHARD_BITS = 4;
+        static constexpr size_t SHARD_COUNT = size_t(1) << SHARD_BITS;
+
+        struct alignas(64) Shard {
+            std::mutex lock;
+            // Keys view the canonical bytes held in `text`.
+            std::unordered_map<string_view, Symbol> symbols;
+            expr::AstArena text;
+            size_t bytes = 0;
+        };
+
+        std::array<Shard, SHARD_COUNT> shards;
+    };
+
+    // The table the scanner interns into: the one a Scope on this thread
+    // installed, or else the process-wide one.
+    SymbolTable& table();
+
+    /**
+     * Makes table() return `symbols` on this thread while the Scope lives.
+     * Threads that scan for another one install a Scope of their own, as
+     * they do a stats::Charge. The table must outlive the Scope.
+     */
+    class Scope {
+    public:
+        explicit Scope(SymbolTable& symbols);
+        ~Scope();
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        SymbolTable* previous;
+    };
+
+    inline Symbol intern(string_view text) { return table().intern(text); }
+
+} // namespace symbol
+
+#endif /* SYMBOL_H */
@@ -0,0 +1,66 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace concurrency {
+
+    /**
+     * Fixed set of worker threads with one task queue each.
+     *
+     * submit() deals tasks out round-robin. A worker takes tasks from the
+     * front of its own queue, so each queue runs roughly in submission order
+     * and results can be consumed in that order as they finish. A worker
+     * whose queue is empty steals from the back of another worker's queue, so
+     * a few slow tasks never leave the other threads idle.
+     */
+    class ThreadPool {
+    public:
+        using Task = std::function<void()>;
+
+        // Zero threads means one per hardware thread.
+        explicit ThreadPool(size_t threads = 0);
+        ~ThreadPool();
+
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        void submit(Task task);
+        // Blocks until every submitted task has run.
+        void wait();
+
+        size_t size() const { return workers.size(); }
+
+    private:
+        struct alignas(64) Queue {
+            std::mutex lock;
+            std::deque<Task> tasks;
+        };
+
+        std::vector<std::unique_ptr<Queue>> queues;
+        std::vector<std::thread> workers;
+        std::atomic<size_t> nextQueue { 0 };
+
+        // Guards sleeping and waking; the counts are what the waits check.
+        std::mutex stateLock;
+        std::condition_variable workAvailable;
+        std::condition_variable allDone;
+        size_t queued = 0;   // submitted but not yet taken
+        size_t pending = 0;  // submitted but not yet finished
+        bool stopping = false;
+
+        void workerLoop(size_t index);
+        bool take(size_t index, Task& task);
+    };
+
+} // namespace concurrency
+
+#endif /* THREADPOOL_H */
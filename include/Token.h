@@ -2,17 +2,23 @@
 #define TOKEN_H
 
 #include <cstddef>
+#include <cstdint>
 #include <iostream>
 #include <iterator> // for std::forward_iterator_tag
 #include <string>
+#include <string_view>
 #include <memory> // for std::shared_ptr
 #include <stdexcept> // for std::runtime_error
 #include <variant> // for std::get, std::variant, std::holds_alternative and std::monostate
 #include <unordered_map>
 
+#include "OutputSink.h"
+#include "Symbol.h"
+
 using std::cout, std::endl;
 using std::monostate;
 using std::string;
+using std::string_view;
 using std::variant;
 using std::shared_ptr;
 using std::make_shared;
@@ -20,10 +26,35 @@ using std::make_shared;
 namespace token {
 
     // exporting this type through the namespace
-    using TokenValue = variant<string, double, bool, monostate>;
+    // Identifiers and string literals are interned symbols. Other textual
+    // lexemes are views into the scanner's source buffer, so a token is only
+    // valid while the buffer it was scanned from is alive. Integer literals
+    // are kept exactly as int64_t, other numbers as double.
+    using TokenValue = variant<string_view, double, int64_t, bool, monostate, symbol::Symbol>;
+
+    // The text of a view or symbol value; empty for anything else.
+    inline string_view textOf(const TokenValue& value) {
+        if (std::holds_alternative<symbol::Symbol>(value)) return std::get<symbol::Symbol>(value).view();
+        if (std::holds_alternative<string_view>(value)) return std::get<string_view>(value);
+        return string_view();
+    }
+
+    inline bool isText(const TokenValue& value) {
+        return std::holds_alternative<symbol::Symbol>(value) || std::holds_alternative<string_view>(value);
+    }
+
+    inline bool isNumber(const TokenValue& value) {
+        return std::holds_alternative<double>(value) || std::holds_alternative<int64_t>(value);
+    }
+
+    // The value of a number of either kind as a double.
+    inline double numberOf(const TokenValue& value) {
+        if (std::holds_alternative<int64_t>(value)) return static_cast<double>(std::get<int64_t>(value));
+        return std::get<double>(value);
+    }
 
     // The order of this matters for the translating the enums to their corresponding string representations
-    enum class TokenType {
+    enum class TokenType : uint8_t {
         NONE = 0,
 
         // Single-character tokens.
@@ -91,28 +122,98 @@ namespace token {
         "END_OF_FILE"     // index 39
     };
 
+    // Source spelling of the tokens whose text is fixed by their type; empty for
+    // identifiers, literals and the other tokens whose text varies.
+    constexpr string_view spelling(TokenType type) {
+        switch (type) {
+            case TokenType::LEFT_PAREN: return "(";
+            case TokenType::RIGHT_PAREN: return ")";
+            case TokenType::LEFT_BRACE: return "{";
+            case TokenType::RIGHT_BRACE: return "}";
+            case TokenType::COMMA: return ",";
+            case TokenType::DOT: return ".";
+            case TokenType::MINUS: return "-";
+            case TokenType::PLUS: return "+";
+            case TokenType::SEMICOLON: return ";";
+            case TokenType::SLASH: return "/";
+            case TokenType::STAR: return "*";
+            case TokenType::BANG: return "!";
+            case TokenType::BANG_EQUAL: return "!=";
+            case TokenType::EQUAL: return "=";
+            case TokenType::EQUAL_EQUAL: return "==";
+            case TokenType::GREATER: return ">";
+            case TokenType::GREATER_EQUAL: return ">=";
+            case TokenType::LESS: return "<";
+            case TokenType::LESS_EQUAL: return "<=";
+            default: return "";
+        }
+    }
+
+    /**
+     * A token and where it is: a byte range of the source. Line and column
+     * are not kept; they are worked out from a source::LineIndex only when
+     * something is actually reported or dumped. Offsets limit a source to
+     * 4 GiB; the length shares a word with the type and saturates at
+     * MAX_LENGTH, which only a string literal of 16 MiB could reach.
+     */
     struct Token {
-        Token() : type(TokenType::NONE), lexeme(""), line(0) {}
-        Token(TokenType type, TokenValue lexeme, int line)
-            : type(type), lexeme(lexeme), line(line) {}
+        static constexpr uint32_t MAX_LENGTH = (1u << 24) - 1;
+
+        Token() : lexeme(string_view()), offset(0), length(0), type(TokenType::NONE) {}
+        Token(TokenType type, TokenValue lexeme, uint32_t offset, uint32_t length = 0)
+            : lexeme(lexeme), offset(offset), length(length < MAX_LENGTH ? length : MAX_LENGTH), type(type) {}
 
-        void print() const {
-            cout << "Token type: " << TokenTypeNames[static_cast<int>(type)];
+        // One past the last byte of the token.
+        uint32_t end() const { return offset + length; }
+
+        void print(output::OutputSink& out, int line) const {
+            out << "Token type: " << TokenTypeNames[static_cast<int>(type)];
             if (type == TokenType::STRING) {
-                cout << ", Literal: " << get<string>(lexeme);
+                out << ", Literal: " << text();
             } else if (type == TokenType::NUMBER) {
-                cout << ", Literal: " << get<double>(lexeme);
+                out << ", Literal: ";
+                out.general(numberOf(lexeme));
             } else {
-                cout << ", Lexeme: " << get<string>(lexeme);
+                out << ", Lexeme: " << text();
+            }
+            out << ", Line: " << line << '\n';
+        }
+
+        // One JSON object per line, for tooling.
+        void printJson(output::OutputSink& out, int line) const {
+            out << "{\"type\":\"" << TokenTypeNames[static_cast<int>(type)] << '"';
+            if (type == TokenType::NUMBER) {
+                out << ",\"value\":";
+                out.shortest(numberOf(lexeme));
+            } else if (type == TokenType::STRING) {
+                out << ",\"value\":";
+                out.jsonString(text());
+            } else if (isText(lexeme)) {
+                out << ",\"lexeme\":";
+                out.jsonString(text());
             }
-            cout << ", Line: " << line << endl;
+            out << ",\"line\":" << line << "}\n";
+        }
+
+        // The lexeme's text, or nothing for tokens without one (errors, end of file).
+        string_view text() const {
+            return textOf(lexeme);
+        }
+
+        // The lexeme as a symbol, interning it if the scanner did not.
+        symbol::Symbol symbol() const {
+            if (std::holds_alternative<symbol::Symbol>(lexeme)) return get<symbol::Symbol>(lexeme);
+            return symbol::intern(text());
         }
 
-        TokenType type;
         TokenValue lexeme;
-        int line;
+        uint32_t offset; // of the first byte in the source
+        uint32_t length : 24;
+        TokenType type : 8;
     };
 
+    static_assert(sizeof(Token) == 32);
+
 } // Token
 
 #endif // TOKEN_H
\ No newline at end of file
@@ -0,0 +1,89 @@
+#ifndef TOKENPIPELINE_H
+#define TOKENPIPELINE_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "LineIndex.h"
+#include "SpscRing.h"
+#include "Stats.h"
+#include "Symbol.h"
+#include "TokenSource.h"
+
+using std::string_view;
+
+namespace parser {
+
+    /**
+     * Lexes on a thread of its own while the parser consumes the tokens, so
+     * the two stages overlap instead of taking turns.
+     *
+     * The scanner thread hands tokens over in batches through a
+     * concurrency::SpscRing and stops when the ring is full. Lexical errors
+     * travel with the batch and are written to `diagnostics` when the parser
+     * reaches the token they came with, as a ScannerTokenSource would have
+     * written them. The last batch ends with END_OF_FILE, or carries
+     * whatever the scanner thread threw, which next() rethrows. The source
+     * must outlive this object. Destroying it early, e.g. after a syntax
+     * error, stops the scanner thread. The scanner thread's allocations are
+     * charged to the thread that created this object (see stats::Charge),
+     * and it interns into that thread's symbol table.
+     */
+    class PipelinedTokenSource : public TokenSource {
+    public:
+        PipelinedTokenSource(string_view source, std::ostream& diagnostics);
+        ~PipelinedTokenSource();
+
+        PipelinedTokenSource(const PipelinedTokenSource&) = delete;
+        PipelinedTokenSource& operator=(const PipelinedTokenSource&) = delete;
+
+        Token next() override;
+
+    private:
+        static constexpr size_t BATCH_SIZE = 512;
+        static constexpr size_t RING_SIZE = 8;
+
+        struct LexicalError {
+            uint32_t index; // of the token it is written before
+            uint32_t offset;
+            std::string message;
+        };
+
+        struct Batch {
+            std::array<Token, BATCH_SIZE> tokens;
+            uint32_t count = 0;
+            std::vector<LexicalError> errors;
+            bool last = false;
+            std::exception_ptr error;
+        };
+
+        string_view source;
+        std::ostream& diagnostics;
+        source::LineIndex lines;
+        concurrency::SpscRing<Batch, RING_SIZE> ring;
+        std::atomic<bool> stopping { false };
+        stats::Account& account; // of the constructing thread, which the scanner thread charges
+        symbol::SymbolTable& symbols; // likewise the table it interns into
+
+        // The consumer's place in the front batch.
+        Batch* reading = nullptr;
+        uint32_t position = 0;
+        size_t reported = 0;
+        bool finished = false;
+        Token endOfFile;
+
+        std::thread producer; // last, so it starts once everything else is ready
+
+        void produce();
+    };
+
+} // namespace parser
+
+#endif /* TOKENPIPELINE_H */
@@ -0,0 +1,62 @@
+#ifndef TOKENSOURCE_H
+#define TOKENSOURCE_H
+
+#include <cstddef>
+#include <vector>
+
+#include "Scanner.h"
+#include "Token.h"
+
+using token::Token;
+using token::TokenType;
+
+namespace parser {
+
+    /**
+     * Where the parser pulls its tokens from, one at a time.
+     * Once the input is exhausted next() keeps returning an END_OF_FILE token.
+     */
+    class TokenSource {
+    public:
+        virtual ~TokenSource() = default;
+        virtual Token next() = 0;
+    };
+
+    // Replays tokens that were already collected into a vector.
+    class VectorTokenSource : public TokenSource {
+    public:
+        VectorTokenSource(const std::vector<Token>& tokens) : tokens(tokens) {}
+
+        Token next() override {
+            if (index < tokens.size()) return tokens[index++];
+            uint32_t offset = tokens.empty() ? 0 : tokens.back().end();
+            return Token(TokenType::END_OF_FILE, TokenValue(), offset);
+        }
+
+    private:
+        const std::vector<Token>& tokens;
+        size_t index = 0;
+    };
+
+    // Lexes on demand: each call scans exactly one more token, so nothing
+    // beyond the parser's lookahead is ever held in memory.
+    class ScannerTokenSource : public TokenSource {
+    public:
+        ScannerTokenSource(scanner::Scanner& scanner) : it(scanner.begin()), end(scanner.end()) {}
+
+        Token next() override {
+            // At the end the iterator still holds the END_OF_FILE token it stopped on.
+            if (it == end) return *it;
+            Token token = *it;
+            ++it;
+            return token;
+        }
+
+    private:
+        scanner::Scanner::Iterator it;
+        scanner::Scanner::Iterator end;
+    };
+
+} // namespace parser
+
+#endif /* TOKENSOURCE_H */
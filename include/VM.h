@@ -0,0 +1,47 @@
+#ifndef VM_H
+#define VM_H
+
+#include <string>
+#include <vector>
+
+#include "Chunk.h"
+#include "OutputSink.h"
+#include "Value.h"
+
+using std::string;
+
+namespace vm {
+
+    enum class InterpretResult {
+        OK,
+        RUNTIME_ERROR,
+    };
+
+    /**
+     * Stack-based virtual machine for compiled Chunks.
+     *
+     * The dispatch loop uses computed gotos where the compiler supports them
+     * (GCC and Clang), so every instruction jumps straight to the next
+     * handler, and falls back to a switch elsewhere.
+     */
+    class VM {
+    public:
+        VM(runtime::Heap& heap, output::OutputSink& out) : heap(heap), out(out) {}
+
+        InterpretResult run(const bytecode::Chunk& chunk);
+
+        // Details of the error that ended the last run with RUNTIME_ERROR.
+        const string& errorMessage() const { return message; }
+        uint32_t errorOffset() const { return offset; }
+
+    private:
+        runtime::Heap& heap;
+        output::OutputSink& out;
+        std::vector<Value> stack;
+        string message;
+        uint32_t offset = 0;
+    };
+
+} // namespace vm
+
+#endif /* VM_H */
@@ -0,0 +1,198 @@
+#ifndef VALUE_H
+#define VALUE_H
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+#include "AstArena.h"
+#include "OutputSink.h"
+
+using std::string_view;
+
+namespace runtime {
+
+    // Heap-allocated string. The characters are either borrowed from the
+    // source (literals) or live in the Heap that made the object.
+    struct StringObject {
+        string_view chars;
+    };
+
+    /**
+     * A runtime value packed into 64 bits with NaN-boxing.
+     *
+     * Any bit pattern that is not one of our quiet NaNs is a plain double.
+     * nil, false and true are quiet NaNs with a small tag in the low bits, and
+     * a string is a quiet NaN with the sign bit set and the StringObject
+     * pointer (48 bits on every platform we target) in the payload. Values are
+     * copied, compared and type-tested with integer operations only; there is
+     * no variant to dispatch on and nothing to allocate for numbers or bools.
+     *
+     * Numbers come in two kinds that the language does not tell apart: small
+     * integers (a quiet NaN with INT_TAG and an int32_t in the low bits) and
+     * doubles. Integer arithmetic stays on integers while the exact result
+     * fits; see add() and friends below.
+     */
+    class Value {
+    public:
+        Value() : bits(NIL_BITS) {}
+        Value(double number) {
+            // NaNs produced by arithmetic are canonicalized so they can never be
+            // mistaken for one of the boxed patterns below.
+            if (number != number) {
+                bits = CANONICAL_NAN;
+            } else {
+                std::memcpy(&bits, &number, sizeof(number));
+            }
+        }
+        Value(bool boolean) : bits(boolean ? TRUE_BITS : FALSE_BITS) {}
+        Value(const StringObject* string) : bits(SIGN_BIT | QNAN | reinterpret_cast<uintptr_t>(string)) {}
+
+        static Value nil() { return Value(); }
+        // A small integer if it fits in 32 bits, else the nearest double.
+        static Value integer(int64_t number) {
+            if (number < INT32_MIN || number > INT32_MAX) return Value(static_cast<double>(number));
+            Value value;
+            value.bits = QNAN | INT_TAG | static_cast<uint32_t>(static_cast<int32_t>(number));
+            return value;
+        }
+
+        bool isNumber() const { return (bits & QNAN) != QNAN || isInteger(); }
+        bool isInteger() const { return (bits & (SIGN_BIT | QNAN | INT_TAG)) == (QNAN | INT_TAG); }
+        bool isNil() const { return bits == NIL_BITS; }
+        bool isBool() const { return (bits | 1) == TRUE_BITS; }
+        bool isString() const { return (bits & (SIGN_BIT | QNAN)) == (SIGN_BIT | QNAN); }
+
+        double asNumber() const {
+            if (isInteger()) return asInteger();
+            double number;
+            std::memcpy(&number, &bits, sizeof(number));
+            return number;
+        }
+        int32_t asInteger() const { return static_cast<int32_t>(static_cast<uint32_t>(bits)); }
+        bool asBool() const { return bits == TRUE_BITS; }
+        const StringObject* asString() const {
+            return reinterpret_cast<const StringObject*>(static_cast<uintptr_t>(bits & ~(SIGN_BIT | QNAN)));
+        }
+
+        // nil and false are falsey, everything else is truthy.
+        bool isTruthy() const { return bits != NIL_BITS && bits != FALSE_BITS; }
+
+        // Numbers compare by IEEE rules (NaN != NaN, 0 == -0), strings by
+        // content, and values of different types are never equal.
+        friend bool operator==(Value a, Value b) {
+            if (a.isInteger() && b.isInteger()) return a.bits == b.bits;
+            if (a.isNumber() && b.isNumber()) return a.asNumber() == b.asNumber();
+            if (a.isString() && b.isString()) return a.asString()->chars == b.asString()->chars;
+            return a.bits == b.bits;
+        }
+
+        uint64_t raw() const { return bits; }
+
+    private:
+        static constexpr uint64_t SIGN_BIT = 0x8000000000000000;
+        static constexpr uint64_t QNAN = 0x7ffc000000000000;
+        static constexpr uint64_t CANONICAL_NAN = 0x7ff8000000000000;
+        static constexpr uint64_t NIL_BITS = QNAN | 1;
+        static constexpr uint64_t FALSE_BITS = QNAN | 2;
+        static constexpr uint64_t TRUE_BITS = QNAN | 3;
+        static constexpr uint64_t INT_TAG = 0x0001000000000000;
+
+        uint64_t bits;
+    };
+
+    static_assert(sizeof(Value) == 8);
+
+    // Arithmetic on two numbers, by the rules of IEEE doubles. When both are
+    // small integers the exact result is computed on integers and kept as one
+    // if it fits and doubles would give the same value; that rules out
+    // inexact quotients and the negative zeros of 0 * -1, 0 / -1 and -0.
+    inline Value add(Value a, Value b) {
+        if (a.isInteger() && b.isInteger()) return Value::integer(int64_t(a.asInteger()) + b.asInteger());
+        return Value(a.asNumber() + b.asNumber());
+    }
+
+    inline Value subtract(Value a, Value b) {
+        if (a.isInteger() && b.isInteger()) return Value::integer(int64_t(a.asInteger()) - b.asInteger());
+        return Value(a.asNumber() - b.asNumber());
+    }
+
+    inline Value multiply(Value a, Value b) {
+        if (a.isInteger() && b.isInteger()) {
+            int64_t product = int64_t(a.asInteger()) * b.asInteger();
+            if (product != 0 || (a.asInteger() >= 0 && b.asInteger() >= 0)) return Value::integer(product);
+        }
+        return Value(a.asNumber() * b.asNumber());
+    }
+
+    inline Value divide(Value a, Value b) {
+        if (a.isInteger() && b.isInteger()) {
+            int64_t x = a.asInteger(), y = b.asInteger();
+            if (y != 0 && x % y == 0 && (x != 0 || y > 0)) return Value::integer(x / y);
+        }
+        return Value(a.asNumber() / b.asNumber());
+    }
+
+    inline Value negate(Value a) {
+        if (a.isInteger() && a.asInteger() != 0) return Value::integer(-int64_t(a.asInteger()));
+        return Value(-a.asNumber());
+    }
+
+    // a < b and the other comparisons, on two numbers.
+    inline bool less(Value a, Value b) {
+        if (a.isInteger() && b.isInteger()) return a.asInteger() < b.asInteger();
+        return a.asNumber() < b.asNumber();
+    }
+
+    inline bool lessEqual(Value a, Value b) {
+        if (a.isInteger() && b.isInteger()) return a.asInteger() <= b.asInteger();
+        return a.asNumber() <= b.asNumber();
+    }
+
+    /**
+     * Owns the strings created while a script runs. Objects and the bytes of
+     * concatenated strings are bump-allocated and all freed with the heap.
+     */
+    class Heap {
+    public:
+        // Wraps characters that outlive the heap (e.g. the script source).
+        const StringObject* borrowString(string_view chars) {
+            return arena.make<StringObject>(chars);
+        }
+
+        const StringObject* concatenate(string_view left, string_view right) {
+            char* chars = static_cast<char*>(arena.allocate(left.size() + right.size(), 1));
+            std::memcpy(chars, left.data(), left.size());
+            std::memcpy(chars + left.size(), right.data(), right.size());
+            return arena.make<StringObject>(string_view(chars, left.size() + right.size()));
+        }
+
+    private:
+        expr::AstArena arena;
+    };
+
+    // Writes a value the way the language prints it: numbers in their shortest
+    // round-trip form, strings without quotes.
+    inline void printValue(output::OutputSink& out, Value value) {
+        if (value.isNumber()) {
+            double number = value.asNumber();
+            if (number != number) {
+                out << "nan";
+            } else if (number == HUGE_VAL || number == -HUGE_VAL) {
+                out << (number > 0 ? "inf" : "-inf");
+            } else {
+                out.shortest(number);
+            }
+        } else if (value.isString()) {
+            out << value.asString()->chars;
+        } else if (value.isBool()) {
+            out << (value.asBool() ? "true" : "false");
+        } else {
+            out << "nil";
+        }
+    }
+
+} // namespace runtime
+
+#endif /* VALUE_H */
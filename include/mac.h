@@ -0,0 +1,52 @@
+/*
+ * C interface to the Mac engine (engine::Engine), for hosts that cannot
+ * use the C++ API. Every function is safe to call with the objects it
+ * returned; none of them throws or exits.
+ */
+#ifndef MAC_H
+#define MAC_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct mac_engine mac_engine;
+typedef struct mac_result mac_result;
+
+/* New stages are only ever added at the end. */
+typedef enum {
+    MAC_LEXICAL_ERROR,
+    MAC_SYNTAX_ERROR,
+    MAC_RUNTIME_ERROR,
+    MAC_INTERNAL_ERROR, /* not the script's fault; line and column are 0 */
+    MAC_COMPILE_ERROR   /* only with the VM */
+} mac_stage;
+
+/* use_vm selects the bytecode VM over the tree walker. NULL if out of memory. */
+mac_engine* mac_engine_new(int use_vm);
+void mac_engine_free(mac_engine* engine);
+
+/* Runs `length` bytes of source. NULL if out of memory; any other failure
+   inside the engine is reported as a MAC_INTERNAL_ERROR diagnostic. */
+mac_result* mac_run(mac_engine* engine, const char* source, size_t length);
+void mac_result_free(mac_result* result);
+
+/* Nonzero if the script ran without any error. */
+int mac_result_ok(const mac_result* result);
+/* What the script printed, NUL-terminated; its length is stored if `length` is not NULL. */
+const char* mac_result_output(const mac_result* result, size_t* length);
+
+size_t mac_result_diagnostic_count(const mac_result* result);
+mac_stage mac_result_diagnostic_stage(const mac_result* result, size_t index);
+/* 1-based; the column counts bytes. */
+int mac_result_diagnostic_line(const mac_result* result, size_t index);
+int mac_result_diagnostic_column(const mac_result* result, size_t index);
+const char* mac_result_diagnostic_message(const mac_result* result, size_t index);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MAC_H */
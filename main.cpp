@@ -1,85 +1,681 @@
-#include <iostream>
+#include <algorithm>
+#include <condition_variable>
+#include <cstdlib>
+#include <filesystem>
 #include <fstream>
-#include <string>
+#include <functional>
+#include <iostream>
+#include <mutex>
 #include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
 #include <vector>
+#include "include/Source.h"
+#include "include/LineIndex.h"
 #include "include/Scanner.h"
 #include "include/Parser.h"
+#include "include/ParallelScanner.h"
+#include "include/TokenPipeline.h"
 #include "include/AstPrinter.h"
+#include "include/Interpreter.h"
+#include "include/ConstantFolder.h"
+#include "include/Compiler.h"
+#include "include/VM.h"
+#include "include/OutputSink.h"
+#include "include/ThreadPool.h"
+#include "include/Document.h"
+#include "include/AstCache.h"
+#include "include/HashCons.h"
+#include "include/Stats.h"
 
 using namespace std;
 using namespace token;
 using namespace expr;
 
-void run(string source);
+// Command line switches that change how scripts are processed
+struct Options {
+    // Parse straight off the scanner instead of collecting (and dumping) the tokens first
+    bool stream = false;
+    // Parse into the compact flat::FlatAst layout and print from it
+    bool flat = false;
+    // Dump tokens and trees as JSON lines instead of the human-readable form
+    printer::Format format = printer::Format::SEXPR;
+    // Evaluate each expression and print its value instead of its tree
+    bool eval = false;
+    // Evaluate by compiling to bytecode and running it on the VM instead of walking the tree
+    bool vm = false;
+    // Fold constants and simplify each tree before it is printed or evaluated
+    bool fold = false;
+    // Share identical subtrees while parsing, so a script's trees form one DAG.
+    // --fold then copies what it changes instead of rewriting shared nodes,
+    // and a runtime error in a shared subtree points at its first occurrence.
+    bool hash_cons = false;
+    // Worker threads for several scripts; 0 means one per hardware thread
+    size_t jobs = 0;
+    // Lex a single large script on all the worker threads before parsing it
+    bool parallel_lex = false;
+    // Lex on a thread of its own while the parser works through the tokens
+    bool pipeline = false;
+    // Directory of parsed scripts to load instead of scanning and parsing again
+    string cache_dir;
+    // Report time, tokens, nodes, allocations and peak RSS per phase of each script
+    bool stats = false;
+    // Write the phases of each script as Chrome trace events to this file
+    string trace_path;
+};
+
+static Options options;
+
+// Collects the trace events of all scripts with --trace
+static unique_ptr<stats::Trace> trace;
+
+// Where the output of one script goes. A lone script writes straight to the
+// terminal; scripts run side by side each collect theirs, to be written out
+// in command line order once they are done.
+// Scanner messages go into the output itself, so they stay in place between
+// the tokens and trees around them.
+struct Session {
+    output::OutputSink& out;   // script output
+    ostream& messages;         // scanner messages, an output::SinkStream over `out`
+    ostream& errors;           // parse and runtime errors, --fold reports; see error()
+    stats::Recorder* stats = nullptr; // per-phase totals with --stats or --trace
+
+    // Where errors are written, once the output before them is out.
+    ostream& error() {
+        out.flush();
+        return errors;
+    }
+};
+
+bool run(string_view source, Session& session);
+
+void process(string_view source, const source::LineIndex& lines, Session& session);
+
+bool run_file(const string& path, Session& session);
+
+int run_files(const vector<string>& paths);
 
-void run_file(const char *path);
+bool write_trace();
 
 void run_prompt();
 
+void collect_scripts(const string& arg, vector<string>& paths);
+
 int main(int argc, char **argv) {
-    if (argc > 2) {
-        cout << "Usage: mac [script]" << endl;
-        system("exit(0)");
-    } else if (argc == 2) {
-        run_file(argv[1]);
-        return 0;
-    } else {
+    vector<string> paths;
+    // A directory or an @list stands for many scripts even if it holds just one.
+    bool batch = false;
+    for (int i = 1; i < argc; i++) {
+        string_view arg = argv[i];
+        if (arg == "--stream") {
+            options.stream = true;
+        } else if (arg == "--flat") {
+            options.flat = true;
+        } else if (arg == "--json") {
+            options.format = printer::Format::JSON;
+        } else if (arg == "--eval") {
+            options.eval = true;
+        } else if (arg == "--vm") {
+            options.eval = true;
+            options.vm = true;
+        } else if (arg == "--fold") {
+            options.fold = true;
+        } else if (arg == "--hash-cons") {
+            options.hash_cons = true;
+        } else if (arg == "--parallel-lex") {
+            options.parallel_lex = true;
+        } else if (arg == "--pipeline") {
+            options.pipeline = true;
+        } else if (arg == "--cache-dir" && i + 1 < argc) {
+            options.cache_dir = argv[++i];
+        } else if (arg == "--jobs" && i + 1 < argc) {
+            options.jobs = strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--stats") {
+            options.stats = true;
+        } else if (arg == "--trace" && i + 1 < argc) {
+            options.trace_path = argv[++i];
+        } else if (arg.starts_with("--")) {
+            cout << "Usage: mac [--stream] [--flat] [--json] [--eval] [--vm] [--fold] [--hash-cons] [--jobs N] [--parallel-lex] [--pipeline] "
+                    "[--cache-dir DIR] [--stats] [--trace FILE] "
+                    "[script | directory | @filelist]..." << endl;
+            return 64;
+        } else {
+            batch = batch || arg.starts_with("@") || filesystem::is_directory(argv[i]);
+            collect_scripts(argv[i], paths);
+        }
+    }
+
+    if (paths.empty() && !batch) {
         run_prompt();
         return 0;
     }
+    stats::trackingAllocations = options.stats;
+    if (!options.trace_path.empty()) trace = make_unique<stats::Trace>(options.trace_path);
+    int status;
+    if (paths.size() == 1 && !batch) {
+        output::OutputSink out(stdout);
+        output::SinkStream messages(out);
+        Session session { out, messages, cerr };
+        stats::Recorder recorder(paths[0], trace.get());
+        if (options.stats || trace) session.stats = &recorder;
+        status = run_file(paths[0], session) ? 0 : EXIT_FAILURE;
+        if (options.stats) recorder.print(session.error(), options.format == printer::Format::JSON);
+    } else {
+        // The scripts are already spread over the threads; one pool is enough.
+        options.parallel_lex = false;
+        options.pipeline = false;
+        status = run_files(paths);
+    }
+    return write_trace() ? status : EXIT_FAILURE;
 }
 
-void run(string source) {
+bool write_trace() {
+    if (!trace || trace->write()) return true;
+    cerr << "Could not write trace file: " << options.trace_path << endl;
+    return false;
+}
 
-    scanner::Scanner scanner(source);
-    vector<Token> tokens;
-    for (auto& token : scanner) {
-        tokens.push_back(token);
-        token.print();
-    }
-
-    parser::Parser parser(tokens);
-    parser.parse();
-
-    // This is what a parsed expression looks like
-    auto expression = make_shared<expr::Binary>(
-        make_shared<expr::Unary>(
-            Token(TokenType::MINUS, TokenValue("-"), 1),
-            make_shared<expr::Literal>(123.45)
-        ),
-        Token(TokenType::STAR, TokenValue("*"), 1),
-        make_shared<expr::Grouping>(
-            make_shared<expr::Literal>("String literal")
-        )
-    );
-}
-
-void run_file(const char *path) {
-    ifstream source_file(path);
-    if (!source_file.is_open()) {
-        cout << "Could not open file for reading: " << path << endl;
+// Expands one command line argument into script paths: a directory into the
+// .mac files below it (sorted, so runs are reproducible) and @list into the
+// paths listed in that file, one per line.
+void collect_scripts(const string& arg, vector<string>& paths) {
+    if (arg.starts_with("@")) {
+        ifstream list(arg.substr(1));
+        if (!list) {
+            cout << "Could not open file for reading: " << arg.substr(1) << endl;
+            return;
+        }
+        string line;
+        while (getline(list, line)) {
+            line.erase(line.find_last_not_of(" \r\t") + 1);
+            if (!line.empty() && !line.starts_with("@")) collect_scripts(line, paths);
+        }
         return;
     }
-    string buffer;
-    ostringstream output_stream;
 
-    while (getline(source_file, buffer)) {
-        output_stream << buffer << '\n';
+    error_code error;
+    if (!filesystem::is_directory(arg, error)) {
+        paths.push_back(arg);
+        return;
+    }
+    vector<string> found;
+    for (auto it = filesystem::recursive_directory_iterator(arg, error);
+         it != filesystem::recursive_directory_iterator(); it.increment(error)) {
+        if (error) break;
+        if (it->is_regular_file(error) && it->path().extension() == ".mac") found.push_back(it->path().string());
     }
-    source_file.close();
+    sort(found.begin(), found.end());
+    paths.insert(paths.end(), found.begin(), found.end());
+}
 
-    run(output_stream.str());
+// What running one script of a batch produced, kept until its turn to be written.
+struct ScriptResult {
+    string output;
+    string errors;
+    string stats;
+    bool ok = true;
+    bool done = false;
+};
+
+// Scans, parses and runs the scripts concurrently, then writes each one's
+// output and diagnostics in the order the scripts were given, as soon as it
+// and everything before it are done. Diagnostics are prefixed with the path;
+// --stats reports name the script themselves and follow them as they are.
+int run_files(const vector<string>& paths) {
+    vector<ScriptResult> results(paths.size());
+    mutex lock;
+    condition_variable finished;
+
+    concurrency::ThreadPool pool(options.jobs);
+    for (size_t i = 0; i < paths.size(); i++) {
+        pool.submit([&, i] {
+            output::OutputSink out;
+            output::SinkStream messages(out);
+            ostringstream errors;
+            Session session { out, messages, errors };
+            stats::Recorder recorder(paths[i], trace.get());
+            if (options.stats || trace) session.stats = &recorder;
+            bool ok;
+            try {
+                ok = run_file(paths[i], session);
+            } catch (const exception& error) {
+                errors << "Error: " << error.what() << '\n';
+                ok = false;
+            }
+            ostringstream report;
+            if (options.stats) recorder.print(report, options.format == printer::Format::JSON);
+            lock_guard<mutex> guard(lock);
+            results[i].output = out.take();
+            results[i].errors = errors.str();
+            results[i].stats = report.str();
+            results[i].ok = ok;
+            results[i].done = true;
+            finished.notify_all();
+        });
+    }
+
+    bool ok = true;
+    for (size_t i = 0; i < paths.size(); i++) {
+        ScriptResult result;
+        {
+            unique_lock<mutex> guard(lock);
+            finished.wait(guard, [&] { return results[i].done; });
+            result = std::move(results[i]);
+        }
+        fwrite(result.output.data(), 1, result.output.size(), stdout);
+        if (!result.errors.empty() || !result.stats.empty()) {
+            fflush(stdout);
+            istringstream lines(result.errors);
+            string line;
+            while (getline(lines, line)) cerr << paths[i] << ": " << line << '\n';
+            if (options.stats && options.format != printer::Format::JSON) cerr << paths[i] << ":\n";
+            cerr << result.stats;
+            cerr.flush();
+        }
+        ok = ok && result.ok;
+    }
+    fflush(stdout);
+    pool.wait();
+    return ok ? 0 : EXIT_FAILURE;
+}
+
+// Reports what --fold did once a script has been processed
+void report_folding(const optimizer::ConstantFolder& folder, Session& session) {
+    const optimizer::FoldStats& stats = folder.stats();
+    session.error() << "[fold] " << stats.foldedNodes << " nodes folded, " << stats.strippedGroupings
+         << " groupings stripped, " << stats.simplifiedNodes << " nodes simplified away" << endl;
 }
 
+// Reports what --hash-cons shared once a script has been processed
+void report_sharing(const expr::HashConsBuilder& builder, Session& session) {
+    session.error() << "[hash-cons] " << builder.built() << " nodes parsed, " << builder.unique() << " unique" << endl;
+}
+
+// A shared subtree has the source offsets of its first occurrence only, so
+// a runtime error inside it may really be at a later one.
+void note_shared_location(Session& session) {
+    session.error() << "[hash-cons] Shared subexpressions report errors at their first occurrence" << endl;
+}
+
+// Hands out a script's expressions one at a time and nullptr after the last:
+// the parser's next(), or trees expanded from a cached flat::FlatAst.
+using NextExpression = function<Expr*()>;
+
+// next(), timed as parsing and its nodes counted when stats are on.
+Expr* parse_next(const NextExpression& next, Session& session) {
+    Expr* expression;
+    {
+        stats::Scope parse(session.stats, stats::Phase::PARSE, false);
+        expression = next();
+    }
+    if (session.stats != nullptr && expression != nullptr) {
+        (*session.stats)[stats::Phase::PARSE].nodes += stats::countNodes(expression);
+    }
+    return expression;
+}
+
+void print_expressions(const NextExpression& next, AstArena& arena, Session& session) {
+    stats::Scope print(session.stats, stats::Phase::PRINT);
+    printer::AstPrinter printer(session.out, options.format);
+    optimizer::ConstantFolder folder(arena, options.hash_cons);
+    while (true) {
+        // Each tree is dropped as soon as it has been printed, unless
+        // --hash-cons shares its nodes with the trees after it.
+        auto mark = arena.mark();
+        Expr *expression = parse_next(next, session);
+        if (expression == nullptr) break;
+        if (options.fold) expression = folder.fold(expression);
+        printer.print(expression);
+        if (!options.hash_cons) arena.rewind(mark);
+    }
+    if (options.fold) report_folding(folder, session);
+}
+
+void run_on_vm(const NextExpression& next, AstArena& arena, const source::LineIndex& lines, Session& session) {
+    runtime::Heap heap;
+    bytecode::Chunk chunk;
+    bytecode::Compiler compiler(chunk, heap);
+    optimizer::ConstantFolder folder(arena, options.hash_cons);
+    while (true) {
+        auto mark = arena.mark();
+        Expr *expression = parse_next(next, session);
+        if (expression == nullptr) break;
+        if (options.fold) expression = folder.fold(expression);
+        compiler.compile(expression);
+        if (!options.hash_cons) arena.rewind(mark);
+    }
+    compiler.finish();
+    if (options.fold) report_folding(folder, session);
+
+    vm::VM machine(heap, session.out);
+    if (machine.run(chunk) == vm::InterpretResult::RUNTIME_ERROR) {
+        session.error() << machine.errorMessage() << "\n[" << lines.position(machine.errorOffset()) << "]" << endl;
+        if (options.hash_cons) note_shared_location(session);
+    }
+}
+
+void evaluate_expressions(const NextExpression& next, AstArena& arena, const source::LineIndex& lines, Session& session) {
+    stats::Scope eval(session.stats, stats::Phase::EVAL);
+    if (options.vm) {
+        run_on_vm(next, arena, lines, session);
+        return;
+    }
+
+    runtime::Heap heap;
+    interpreter::Interpreter interpreter(heap);
+    optimizer::ConstantFolder folder(arena, options.hash_cons);
+    while (true) {
+        auto mark = arena.mark();
+        Expr *expression = parse_next(next, session);
+        if (expression == nullptr) break;
+        if (options.fold) expression = folder.fold(expression);
+        try {
+            runtime::printValue(session.out, interpreter.evaluate(expression));
+            session.out << '\n';
+        } catch (const interpreter::RuntimeError& error) {
+            session.error() << error.what() << "\n[" << lines.position(error.token.offset) << "]" << endl;
+            if (options.hash_cons) note_shared_location(session);
+            break;
+        }
+        if (!options.hash_cons) arena.rewind(mark);
+    }
+    if (options.fold) report_folding(folder, session);
+}
+
+// Returns false if the script has a syntax error, or with --vm one that does
+// not compile, which ends its processing.
+bool run(string_view source, Session& session) {
+    // Lines and columns are only worked out if something is reported.
+    source::LineIndex lines(source);
+    try {
+        process(source, lines, session);
+    } catch (const parser::ParseError& error) {
+        session.error() << "Error on " << lines.position(error.token.offset) << ": " << error.what() << endl;
+        return false;
+    } catch (const bytecode::CompileError& error) {
+        session.error() << "Error on " << lines.position(error.offset) << ": " << error.what() << endl;
+        return false;
+    }
+    return true;
+}
+
+// Lexes the whole script up front on a pool of worker threads.
+vector<Token> lex_in_parallel(string_view source, Session& session) {
+    stats::Scope lex(session.stats, stats::Phase::LEX);
+    concurrency::ThreadPool pool(options.jobs);
+    vector<Token> tokens = scanner::scanParallel(source, pool, session.messages);
+    if (session.stats != nullptr) (*session.stats)[stats::Phase::LEX].tokens += tokens.size() - 1;
+    return tokens;
+}
+
+// Where the parser gets its tokens: lexed on demand, with --pipeline lexed
+// ahead on another thread, or with --parallel-lex lexed in parallel first
+// and then replayed. Tokens not lexed up front are timed one by one when
+// stats are on (with --pipeline, the time spent waiting for them).
+class ScriptTokens {
+public:
+    ScriptTokens(string_view source, Session& session) : scanner(source, session.messages) {
+        if (options.parallel_lex) {
+            lexed = lex_in_parallel(source, session);
+            feed = make_unique<parser::VectorTokenSource>(lexed);
+            return;
+        }
+        // On a single hardware thread the two stages could only take turns.
+        if (options.pipeline && thread::hardware_concurrency() > 1) {
+            feed = make_unique<parser::PipelinedTokenSource>(source, session.messages);
+        } else {
+            feed = make_unique<parser::ScannerTokenSource>(scanner);
+        }
+        if (session.stats != nullptr) timed = make_unique<stats::TimedTokens>(*feed, *session.stats);
+    }
+
+    parser::TokenSource& source() { return timed ? *timed : *feed; }
+
+private:
+    scanner::Scanner scanner;
+    vector<Token> lexed;
+    unique_ptr<parser::TokenSource> feed;
+    unique_ptr<parser::TokenSource> timed;
+};
+
+// With --cache-dir the script's tree comes from the cache, or is parsed and
+// added to it, and the scanner and parser never run on a hit. The token dump
+// needs the tokens, so it always scans. Returns false for scripts with
+// errors, which are never cached and are processed the usual way.
+bool process_cached(string_view source, const source::LineIndex& lines, Session& session) {
+    cache::AstCache parsed(options.cache_dir);
+    unique_ptr<cache::CachedAst> cached;
+    {
+        stats::Scope parse(session.stats, stats::Phase::PARSE);
+        cached = parsed.get(source);
+    }
+    if (!cached) return false;
+    const flat::FlatAst& ast = cached->ast();
+    output::OutputSink& out = session.out;
+    if (options.flat) {
+        if (session.stats != nullptr) (*session.stats)[stats::Phase::PARSE].nodes += ast.size();
+        stats::Scope print(session.stats, stats::Phase::PRINT);
+        printer::FlatAstPrinter printer(ast, out, options.format);
+        for (size_t root = 0; root < ast.roots.size(); root++) {
+            printer.print(root);
+        }
+    } else {
+        AstArena arena;
+        size_t root = 0;
+        auto next = [&]() -> Expr* {
+            return root < ast.roots.size() ? cache::expand(ast, root++, arena) : nullptr;
+        };
+        if (options.eval) {
+            evaluate_expressions(next, arena, lines, session);
+        } else {
+            print_expressions(next, arena, session);
+        }
+    }
+    out.flush();
+    return true;
+}
+
+void process(string_view source, const source::LineIndex& lines, Session& session) {
+    output::OutputSink& out = session.out;
+    if (!options.cache_dir.empty() && (options.flat || options.stream || options.eval)) {
+        if (process_cached(source, lines, session)) return;
+    }
+    if (options.flat) {
+        ScriptTokens tokens(source, session);
+        AstArena arena;
+        parser::Parser parser(tokens.source(), arena);
+        flat::FlatAst ast;
+        {
+            stats::Scope parse(session.stats, stats::Phase::PARSE);
+            parser.parse(ast);
+        }
+        if (session.stats != nullptr) (*session.stats)[stats::Phase::PARSE].nodes += ast.size();
+        stats::Scope print(session.stats, stats::Phase::PRINT);
+        printer::FlatAstPrinter printer(ast, out, options.format);
+        for (size_t root = 0; root < ast.roots.size(); root++) {
+            printer.print(root);
+        }
+        out.flush();
+        return;
+    }
+
+    if (options.stream || options.eval) {
+        ScriptTokens tokens(source, session);
+        AstArena arena;
+        parser::Parser parser(tokens.source(), arena);
+        expr::HashConsBuilder shared(arena);
+        auto next = [&] { return options.hash_cons ? parser.next(shared) : parser.next(); };
+        if (options.eval) {
+            evaluate_expressions(next, arena, lines, session);
+        } else {
+            print_expressions(next, arena, session);
+        }
+        if (options.hash_cons) report_sharing(shared, session);
+        out.flush();
+        return;
+    }
+
+    auto dump = [&](const Token& token) {
+        if (options.format == printer::Format::JSON) {
+            token.printJson(out, lines.line(token.offset));
+        } else {
+            token.print(out, lines.line(token.offset));
+        }
+    };
+    // END_OF_FILE is kept for the parser, so errors at the end point at the
+    // end of the script, but not dumped.
+    vector<Token> tokens;
+    if (options.parallel_lex) {
+        tokens = lex_in_parallel(source, session);
+        stats::Scope print(session.stats, stats::Phase::PRINT);
+        for (size_t i = 0; i + 1 < tokens.size(); i++) dump(tokens[i]);
+    } else {
+        // The dump goes along with the scan, each token timed as printing.
+        stats::Scope lex(session.stats, stats::Phase::LEX);
+        scanner::Scanner scanner(source, session.messages);
+        auto it = scanner.begin();
+        for (; it != scanner.end(); ++it) {
+            tokens.push_back(*it);
+            stats::Scope print(session.stats, stats::Phase::PRINT, false);
+            dump(*it);
+        }
+        tokens.push_back(*it);
+        if (session.stats != nullptr) (*session.stats)[stats::Phase::LEX].tokens += tokens.size() - 1;
+    }
+
+    AstArena arena;
+    parser::Parser parser(tokens, arena);
+    expr::HashConsBuilder shared(arena);
+    print_expressions([&] { return options.hash_cons ? parser.next(shared) : parser.next(); }, arena, session);
+    if (options.hash_cons) report_sharing(shared, session);
+    out.flush();
+}
+
+bool run_file(const string& path, Session& session) {
+    // The scanner reads straight out of the mapping; nothing is copied.
+    source::SourceFile source_file = [&] {
+        stats::Scope load(session.stats, stats::Phase::LOAD);
+        return source::SourceFile(path.c_str());
+    }();
+    if (source_file.isTooLarge()) {
+        session.error() << "Script too large (the limit is 4 GiB): " << path << endl;
+        return false;
+    }
+    if (!source_file.isOpen()) {
+        session.messages << "Could not open file for reading: " << path << endl;
+        return true;
+    }
+
+    return run(source_file.view(), session);
+}
+
+// Runs one top-level expression typed at the prompt, the way process()
+// would have run it as part of a script. Returns false if it has errors.
+bool run_segment(const incremental::Document& document, size_t index, Session& session) {
+    const incremental::Segment& segment = document.segment(index);
+    for (const auto& error : segment.lexicalErrors) {
+        session.messages << error.message << " on " << document.position(index, error.offset) << endl;
+    }
+    if (!segment.error.empty()) {
+        session.error() << "Error on " << document.position(index, segment.errorOffset) << ": " << segment.error << endl;
+    }
+    if (!segment.lexicalErrors.empty() || !segment.error.empty()) return false;
+    if (segment.root == nullptr) return true; // only blanks and comments
+
+    output::OutputSink& out = session.out;
+    if (!options.eval && !options.stream && !options.flat) {
+        for (const Token& token : segment.tokens) {
+            int line = document.position(index, token.offset).line;
+            if (options.format == printer::Format::JSON) {
+                token.printJson(out, line);
+            } else {
+                token.print(out, line);
+            }
+        }
+    }
+
+    // The segment's tree is left as it was parsed: folding copies what it
+    // changes into a scratch arena.
+    AstArena scratch;
+    optimizer::ConstantFolder folder(scratch, true);
+    Expr* expression = options.fold ? folder.fold(segment.root) : segment.root;
+    if (!options.eval) {
+        printer::AstPrinter(out, options.format).print(expression);
+    } else if (options.vm) {
+        runtime::Heap heap;
+        bytecode::Chunk chunk;
+        bytecode::Compiler compiler(chunk, heap);
+        try {
+            compiler.compile(expression);
+        } catch (const bytecode::CompileError& error) {
+            session.error() << "Error on " << document.position(index, error.offset) << ": " << error.what() << endl;
+            return false;
+        }
+        compiler.finish();
+        vm::VM machine(heap, out);
+        if (machine.run(chunk) == vm::InterpretResult::RUNTIME_ERROR) {
+            session.error() << machine.errorMessage() << "\n[" << document.position(index, machine.errorOffset()) << "]" << endl;
+        }
+    } else {
+        runtime::Heap heap;
+        interpreter::Interpreter interpreter(heap);
+        try {
+            runtime::printValue(out, interpreter.evaluate(expression));
+            out << '\n';
+        } catch (const interpreter::RuntimeError& error) {
+            session.error() << error.what() << "\n[" << document.position(index, error.token.offset) << "]" << endl;
+        }
+    }
+    out.flush();
+    if (options.fold) report_folding(folder, session);
+    return true;
+}
+
+// The prompt keeps what is typed in one incremental::Document and runs each
+// expression once it is complete, so an expression can be spread over several
+// lines ("..") and only the new text is lexed and parsed. Whatever has run,
+// or been reported as an error, is sealed: later lines start new expressions
+// and never rerun it, and positions still count its lines. A blank line ends
+// an unfinished expression, which then reports what it is missing.
 void run_prompt() {
-    do {
-        cout << "|> ";
+    output::OutputSink out(stdout);
+    output::SinkStream messages(out);
+    Session session { out, messages, cerr };
+    incremental::Document document;
+    auto pending = [&] {
+        size_t count = document.segmentCount();
+        return count > 0 && document.segment(count - 1).errorAtEnd;
+    };
+    while (true) {
+        out.flush();
+        cout << (pending() ? ".. " : "|> ");
         string line;
-        getline(cin, line);
+        if (!getline(cin, line)) break;
         // strip trailing spaces
         line.erase(line.find_last_not_of(" \n\r\t") + 1);
         if (line == "exit") break;
-        run(line);
-    } while (true);
-}
\ No newline at end of file
+
+        if (line.empty() && pending()) {
+            run_segment(document, document.segmentCount() - 1, session);
+            // The blank line is sealed too, so the lines after it count it.
+            document.append("\n");
+            document.seal(document.segmentCount());
+            continue;
+        }
+
+        document.append(line + "\n");
+        // Everything but an unfinished last expression has been sealed, so
+        // every other segment is new; the unfinished one runs once it is
+        // complete. As in a script, nothing after an error runs: the rest of
+        // the line is dropped.
+        size_t end = document.segmentCount() - (pending() ? 1 : 0);
+        for (size_t i = 0; i < end; i++) {
+            if (!run_segment(document, i, session)) {
+                end = document.segmentCount();
+                break;
+            }
+        }
+        document.seal(end);
+    }
+}
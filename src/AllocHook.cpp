@@ -0,0 +1,108 @@
+#include "Stats.h"
+
+#include <cstdlib>
+#include <new>
+
+// The global allocation functions, replaced as a whole so that every form
+// is counted and memory always goes back the way it came. Aligned blocks
+// come from a separate allocator on Windows, so every delete of them has
+// to be the aligned form; elsewhere everything ends in free().
+//
+// Only the mac and mac_bench executables link this file. libmac itself
+// leaves the allocator alone, so a host keeps whatever it already uses.
+
+namespace {
+
+    void* allocate(std::size_t size) {
+        if (stats::trackingAllocations.load(std::memory_order_relaxed)) stats::currentAccount().note(size);
+        if (size == 0) size = 1;
+        while (true) {
+            if (void* block = std::malloc(size)) return block;
+            std::new_handler handler = std::get_new_handler();
+            if (handler == nullptr) throw std::bad_alloc();
+            handler();
+        }
+    }
+
+    void* allocate(std::size_t size, std::align_val_t alignment) {
+        if (stats::trackingAllocations.load(std::memory_order_relaxed)) stats::currentAccount().note(size);
+        std::size_t align = static_cast<std::size_t>(alignment);
+        // aligned_alloc wants a whole number of alignments.
+        size = (size + align - 1) / align * align;
+        if (size == 0) size = align;
+        while (true) {
+#if defined(_WIN32)
+            if (void* block = _aligned_malloc(size, align)) return block;
+#else
+            if (void* block = std::aligned_alloc(align, size)) return block;
+#endif
+            std::new_handler handler = std::get_new_handler();
+            if (handler == nullptr) throw std::bad_alloc();
+            handler();
+        }
+    }
+
+    void release(void* block) noexcept {
+        std::free(block);
+    }
+
+    void releaseAligned(void* block) noexcept {
+#if defined(_WIN32)
+        _aligned_free(block);
+#else
+        std::free(block);
+#endif
+    }
+
+} // namespace
+
+void* operator new(std::size_t size) { return allocate(size); }
+void* operator new[](std::size_t size) { return allocate(size); }
+void* operator new(std::size_t size, std::align_val_t alignment) { return allocate(size, alignment); }
+void* operator new[](std::size_t size, std::align_val_t alignment) { return allocate(size, alignment); }
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    try {
+        return allocate(size);
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+    try {
+        return allocate(size);
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    try {
+        return allocate(size, alignment);
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    try {
+        return allocate(size, alignment);
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+void operator delete(void* block) noexcept { release(block); }
+void operator delete[](void* block) noexcept { release(block); }
+void operator delete(void* block, std::size_t) noexcept { release(block); }
+void operator delete[](void* block, std::size_t) noexcept { release(block); }
+void operator delete(void* block, const std::nothrow_t&) noexcept { release(block); }
+void operator delete[](void* block, const std::nothrow_t&) noexcept { release(block); }
+
+void operator delete(void* block, std::align_val_t) noexcept { releaseAligned(block); }
+void operator delete[](void* block, std::align_val_t) noexcept { releaseAligned(block); }
+void operator delete(void* block, std::size_t, std::align_val_t) noexcept { releaseAligned(block); }
+void operator delete[](void* block, std::size_t, std::align_val_t) noexcept { releaseAligned(block); }
+void operator delete(void* block, std::align_val_t, const std::nothrow_t&) noexcept { releaseAligned(block); }
+void operator delete[](void* block, std::align_val_t, const std::nothrow_t&) noexcept { releaseAligned(block); }
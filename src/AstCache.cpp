@@ -0,0 +1,343 @@
+#include "AstCache.h"
+
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <thread>
+#include <vector>
+
+#include "Diagnostics.h"
+#include "Parser.h"
+#include "Scanner.h"
+
+using flat::NodeId;
+using flat::NodeKind;
+using std::vector;
+
+namespace cache {
+
+namespace {
+
+    constexpr char MAGIC[8] = { 'M', 'A', 'C', '-', 'A', 'S', 'T', '\n' };
+    // Reads back as something else on a machine of the other byte order.
+    constexpr uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+    struct Header {
+        char magic[8];
+        uint32_t version;
+        uint32_t byteOrder;
+        uint64_t hashLow;
+        uint64_t hashHigh;
+        uint64_t sourceLength;
+        uint32_t nodeCount;
+        uint32_t rootCount;
+        uint32_t constantCount;
+        uint32_t reserved;
+        uint64_t stringBytes;
+    };
+
+    enum ConstantTag : uint8_t { NIL_TAG, BOOL_TAG, NUMBER_TAG, TEXT_TAG, INTEGER_TAG };
+
+    // One entry of the constant pool. Text is stored in the string section;
+    // payload is then its offset there, otherwise the bool or the number's bits.
+    struct StoredConstant {
+        uint8_t tag;
+        uint8_t padding[3];
+        uint32_t length;
+        uint64_t payload;
+    };
+
+    // Byte offsets of the sections, which follow the header in this order.
+    struct Layout {
+        size_t lhs, rhs, offsets, roots, constants, kinds, ops, strings, source, total;
+    };
+
+    size_t alignUp(size_t offset, size_t alignment) {
+        return (offset + alignment - 1) & ~(alignment - 1);
+    }
+
+    Layout layoutOf(const Header& header) {
+        Layout layout;
+        size_t nodes = header.nodeCount;
+        layout.lhs = sizeof(Header);
+        layout.rhs = layout.lhs + nodes * sizeof(uint32_t);
+        layout.offsets = layout.rhs + nodes * sizeof(uint32_t);
+        layout.roots = layout.offsets + nodes * sizeof(uint32_t);
+        layout.constants = alignUp(layout.roots + header.rootCount * sizeof(NodeId), alignof(StoredConstant));
+        layout.kinds = layout.constants + header.constantCount * sizeof(StoredConstant);
+        layout.ops = layout.kinds + nodes;
+        layout.strings = layout.ops + nodes;
+        layout.source = layout.strings + header.stringBytes;
+        layout.total = layout.source + header.sourceLength;
+        return layout;
+    }
+
+    uint64_t finalize(uint64_t x) {
+        x ^= x >> 33;
+        x *= 0xff51afd7ed558ccd;
+        x ^= x >> 33;
+        x *= 0xc4ceb9fe1a85ec53;
+        x ^= x >> 33;
+        return x;
+    }
+
+    template <typename T>
+    void copyOut(vector<T>& into, const char* from, size_t count) {
+        into.resize(count);
+        if (count > 0) std::memcpy(into.data(), from, count * sizeof(T));
+    }
+
+    // Everything expand() and the printers rely on: children come before
+    // their parent and inside its root's run, operands index real constants.
+    bool wellFormed(const flat::FlatAst& ast) {
+        size_t root = 0;
+        NodeId first = 0;
+        for (NodeId node = 0; node < ast.size(); node++) {
+            if (root >= ast.roots.size()) return false;
+            uint32_t a = ast.lhs[node];
+            switch (ast.kinds[node]) {
+                case NodeKind::BINARY:
+                    if (ast.rhs[node] < first || ast.rhs[node] >= node) return false;
+                    [[fallthrough]];
+                case NodeKind::UNARY:
+                    if (token::spelling(ast.op(node)).empty()) return false;
+                    [[fallthrough]];
+                case NodeKind::GROUPING:
+                    if (a < first || a >= node) return false;
+                    break;
+                case NodeKind::LITERAL:
+                    if (a >= ast.constants.size()) return false;
+                    break;
+                case NodeKind::VARIABLE:
+                    if (a >= ast.constants.size() || !token::isText(ast.constants[a])) return false;
+                    break;
+                default:
+                    return false;
+            }
+            if (ast.roots[root] == node) {
+                first = node + 1;
+                root++;
+            }
+        }
+        return root == ast.roots.size();
+    }
+
+} // namespace
+
+ContentHash contentHash(string_view source) {
+    // Two independent multiply-rotate lanes over 8-byte words; only the
+    // final mixing step combines them.
+    constexpr uint64_t K0 = 0x9e3779b97f4a7c15;
+    constexpr uint64_t K1 = 0xc2b2ae3d27d4eb4f;
+    constexpr uint64_t K2 = 0x165667b19e3779f9;
+    uint64_t a = K0 ^ source.size();
+    uint64_t b = K1 + source.size();
+    const char* bytes = source.data();
+    size_t whole = source.size() & ~size_t(7);
+    for (size_t i = 0; i < whole; i += 8) {
+        uint64_t word;
+        std::memcpy(&word, bytes + i, sizeof(word));
+        a = std::rotl(a ^ word, 29) * K1;
+        b = std::rotl(b ^ (word * K0), 31) * K2;
+    }
+    uint64_t tail = 0;
+    std::memcpy(&tail, bytes + whole, source.size() - whole);
+    a = std::rotl(a ^ tail, 29) * K1;
+    b = std::rotl(b ^ (tail * K0), 31) * K2;
+    return ContentHash { finalize(a ^ std::rotl(b, 17)), finalize(b + a * K0) };
+}
+
+string AstCache::pathFor(const ContentHash& hash) const {
+    char name[40];
+    std::snprintf(name, sizeof(name), "%016llx%016llx.ast",
+                  static_cast<unsigned long long>(hash.high), static_cast<unsigned long long>(hash.low));
+    return (std::filesystem::path(directory) / name).string();
+}
+
+std::unique_ptr<CachedAst> AstCache::get(string_view source) const {
+    ContentHash hash = contentHash(source);
+    if (auto cached = load(hash, source)) return cached;
+
+    auto cached = std::make_unique<CachedAst>();
+    diagnostics::Diagnostics errors;
+    scanner::Scanner scanner(source, errors);
+    expr::AstArena unused; // the flat layout does not allocate from it
+    parser::Parser parser(scanner, unused);
+    try {
+        parser.parse(cached->tree);
+    } catch (const parser::ParseError&) {
+        return nullptr;
+    }
+    if (!errors.empty()) return nullptr;
+    // A cache that cannot be written to only costs the next run a parse.
+    store(hash, source, cached->tree);
+    return cached;
+}
+
+std::unique_ptr<CachedAst> AstCache::load(const ContentHash& hash, string_view source) const {
+    // A cache file holds a copy of the script and more, so it may be larger.
+    auto file = std::make_unique<source::SourceFile>(pathFor(hash).c_str(), SIZE_MAX);
+    string_view bytes = file->view();
+    Header header;
+    if (!file->isOpen() || bytes.size() < sizeof(Header)) return nullptr;
+    std::memcpy(&header, bytes.data(), sizeof(header));
+    if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != FORMAT_VERSION
+        || header.byteOrder != BYTE_ORDER_MARK || header.hashLow != hash.low || header.hashHigh != hash.high
+        || header.sourceLength != source.size()) {
+        return nullptr;
+    }
+    Layout layout = layoutOf(header);
+    if (layout.total != bytes.size()) return nullptr;
+    // The hash only picks the file; the text decides.
+    if (!source.empty() && std::memcmp(bytes.data() + layout.source, source.data(), source.size()) != 0) return nullptr;
+
+    auto cached = std::make_unique<CachedAst>();
+    flat::FlatAst& ast = cached->tree;
+    const char* base = bytes.data();
+    copyOut(ast.kinds, base + layout.kinds, header.nodeCount);
+    copyOut(ast.ops, base + layout.ops, header.nodeCount);
+    copyOut(ast.lhs, base + layout.lhs, header.nodeCount);
+    copyOut(ast.rhs, base + layout.rhs, header.nodeCount);
+    copyOut(ast.offsets, base + layout.offsets, header.nodeCount);
+    copyOut(ast.roots, base + layout.roots, header.rootCount);
+
+    ast.constants.clear();
+    ast.constants.reserve(header.constantCount);
+    const char* strings = base + layout.strings;
+    for (uint32_t i = 0; i < header.constantCount; i++) {
+        StoredConstant stored;
+        std::memcpy(&stored, base + layout.constants + i * sizeof(StoredConstant), sizeof(stored));
+        switch (stored.tag) {
+            case NIL_TAG: ast.constants.emplace_back(monostate {}); break;
+            case BOOL_TAG: ast.constants.emplace_back(stored.payload != 0); break;
+            case NUMBER_TAG: ast.constants.emplace_back(std::bit_cast<double>(stored.payload)); break;
+            case INTEGER_TAG: ast.constants.emplace_back(std::bit_cast<int64_t>(stored.payload)); break;
+            case TEXT_TAG:
+                if (stored.payload > header.stringBytes || stored.length > header.stringBytes - stored.payload) return nullptr;
+                ast.constants.emplace_back(string_view(strings + stored.payload, stored.length));
+                break;
+            default:
+                return nullptr;
+        }
+    }
+    if (!wellFormed(ast)) return nullptr;
+    cached->file = std::move(file);
+    return cached;
+}
+
+bool AstCache::store(const ContentHash& hash, string_view source, const flat::FlatAst& ast) const {
+    vector<StoredConstant> constants;
+    constants.reserve(ast.constants.size());
+    string strings;
+    for (const TokenValue& value : ast.constants) {
+        StoredConstant stored {};
+        if (token::isText(value)) {
+            string_view text = token::textOf(value);
+            stored.tag = TEXT_TAG;
+            stored.length = static_cast<uint32_t>(text.size());
+            stored.payload = strings.size();
+            strings.append(text);
+        } else if (std::holds_alternative<int64_t>(value)) {
+            stored.tag = INTEGER_TAG;
+            stored.payload = std::bit_cast<uint64_t>(std::get<int64_t>(value));
+        } else if (std::holds_alternative<double>(value)) {
+            stored.tag = NUMBER_TAG;
+            stored.payload = std::bit_cast<uint64_t>(std::get<double>(value));
+        } else if (std::holds_alternative<bool>(value)) {
+            stored.tag = BOOL_TAG;
+            stored.payload = std::get<bool>(value) ? 1 : 0;
+        } else {
+            stored.tag = NIL_TAG;
+        }
+        constants.push_back(stored);
+    }
+
+    Header header {};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = FORMAT_VERSION;
+    header.byteOrder = BYTE_ORDER_MARK;
+    header.hashLow = hash.low;
+    header.hashHigh = hash.high;
+    header.sourceLength = source.size();
+    header.nodeCount = static_cast<uint32_t>(ast.size());
+    header.rootCount = static_cast<uint32_t>(ast.roots.size());
+    header.constantCount = static_cast<uint32_t>(constants.size());
+    header.stringBytes = strings.size();
+    Layout layout = layoutOf(header);
+
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+    // Written under a name of its own and renamed into place, so a reader
+    // (or another writer of the same script) never sees half a file.
+    string path = pathFor(hash);
+    string temporary = path + '.' + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()))
+        + '.' + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count());
+    FILE* out = std::fopen(temporary.c_str(), "wb");
+    if (out == nullptr) return false;
+    auto write = [&](const void* data, size_t size) { return size == 0 || std::fwrite(data, 1, size, out) == size; };
+    static const char zeros[alignof(StoredConstant)] = {};
+    size_t rootsEnd = layout.roots + ast.roots.size() * sizeof(NodeId);
+    bool ok = write(&header, sizeof(header))
+        && write(ast.lhs.data(), ast.lhs.size() * sizeof(uint32_t))
+        && write(ast.rhs.data(), ast.rhs.size() * sizeof(uint32_t))
+        && write(ast.offsets.data(), ast.offsets.size() * sizeof(uint32_t))
+        && write(ast.roots.data(), ast.roots.size() * sizeof(NodeId))
+        && write(zeros, layout.constants - rootsEnd)
+        && write(constants.data(), constants.size() * sizeof(StoredConstant))
+        && write(ast.kinds.data(), ast.kinds.size())
+        && write(ast.ops.data(), ast.ops.size())
+        && write(strings.data(), strings.size())
+        && write(source.data(), source.size());
+    ok = std::fclose(out) == 0 && ok;
+    if (ok) std::filesystem::rename(temporary, path, error);
+    if (!ok || error) {
+        std::filesystem::remove(temporary, error);
+        return false;
+    }
+    return true;
+}
+
+expr::Expr* expand(const flat::FlatAst& ast, size_t rootIndex, expr::AstArena& arena) {
+    expr::TreeBuilder builder(arena);
+    NodeId first = ast.firstNodeOf(rootIndex);
+    NodeId root = ast.roots[rootIndex];
+    // The root's run is in post-order, so every child is built before its parent.
+    vector<expr::Expr*> built(root - first + 1);
+    for (NodeId node = first; node <= root; node++) {
+        uint32_t offset = ast.offsets[node];
+        expr::Expr* child = ast.kinds[node] == NodeKind::LITERAL || ast.kinds[node] == NodeKind::VARIABLE
+            ? nullptr : built[ast.lhs[node] - first];
+        switch (ast.kinds[node]) {
+            case NodeKind::BINARY: {
+                string_view spelling = token::spelling(ast.op(node));
+                Token op(ast.op(node), TokenValue(spelling), offset, static_cast<uint32_t>(spelling.size()));
+                built[node - first] = builder.binary(child, op, built[ast.rhs[node] - first]);
+                break;
+            }
+            case NodeKind::UNARY: {
+                string_view spelling = token::spelling(ast.op(node));
+                Token op(ast.op(node), TokenValue(spelling), offset, static_cast<uint32_t>(spelling.size()));
+                built[node - first] = builder.unary(op, child);
+                break;
+            }
+            case NodeKind::GROUPING:
+                built[node - first] = builder.grouping(child, Token());
+                break;
+            case NodeKind::LITERAL:
+                built[node - first] = builder.literal(ast.constants[ast.lhs[node]], Token());
+                break;
+            case NodeKind::VARIABLE: {
+                string_view name = token::textOf(ast.constants[ast.lhs[node]]);
+                built[node - first] = builder.variable(Token(TokenType::IDENTIFIER, name, offset, static_cast<uint32_t>(name.size())));
+                break;
+            }
+        }
+    }
+    return built.back();
+}
+
+} // namespace cache
@@ -0,0 +1,93 @@
+#include "mac.h"
+
+#include <exception>
+#include <new>
+
+#include "Engine.h"
+
+struct mac_engine {
+    engine::Engine engine;
+};
+
+struct mac_result {
+    engine::Result result;
+};
+
+// A result holding just an internal error, or NULL if even that cannot be
+// allocated.
+static mac_result* failure(const char* message) noexcept {
+    try {
+        mac_result* result = new mac_result {};
+        result->result.diagnostics.push_back(diagnostics::Diagnostic { diagnostics::Stage::INTERNAL, 0, message });
+        return result;
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+extern "C" {
+
+mac_engine* mac_engine_new(int use_vm) {
+    engine::Options options;
+    options.vm = use_vm != 0;
+    return new (std::nothrow) mac_engine { engine::Engine(options) };
+}
+
+void mac_engine_free(mac_engine* engine) {
+    delete engine;
+}
+
+mac_result* mac_run(mac_engine* engine, const char* source, size_t length) {
+    try {
+        return new mac_result { engine->engine.run(string_view(source, length)) };
+    } catch (const std::bad_alloc&) {
+        return nullptr;
+    } catch (const std::exception& error) {
+        // Nothing may unwind into the C caller.
+        return failure(error.what());
+    } catch (...) {
+        return failure("Internal error");
+    }
+}
+
+void mac_result_free(mac_result* result) {
+    delete result;
+}
+
+int mac_result_ok(const mac_result* result) {
+    return result->result.ok() ? 1 : 0;
+}
+
+const char* mac_result_output(const mac_result* result, size_t* length) {
+    if (length != nullptr) *length = result->result.output.size();
+    return result->result.output.c_str();
+}
+
+size_t mac_result_diagnostic_count(const mac_result* result) {
+    return result->result.diagnostics.size();
+}
+
+mac_stage mac_result_diagnostic_stage(const mac_result* result, size_t index) {
+    switch (result->result.diagnostics[index].stage) {
+        case diagnostics::Stage::LEXICAL: return MAC_LEXICAL_ERROR;
+        case diagnostics::Stage::SYNTAX: return MAC_SYNTAX_ERROR;
+        case diagnostics::Stage::COMPILE: return MAC_COMPILE_ERROR;
+        case diagnostics::Stage::RUNTIME: return MAC_RUNTIME_ERROR;
+        case diagnostics::Stage::INTERNAL: return MAC_INTERNAL_ERROR;
+    }
+    return MAC_INTERNAL_ERROR;
+}
+
+int mac_result_diagnostic_line(const mac_result* result, size_t index) {
+    return result->result.diagnostics[index].line;
+}
+
+int mac_result_diagnostic_column(const mac_result* result, size_t index) {
+    return result->result.diagnostics[index].column;
+}
+
+const char* mac_result_diagnostic_message(const mac_result* result, size_t index) {
+    return result->result.diagnostics[index].message.c_str();
+}
+
+} // extern "C"
@@ -0,0 +1,119 @@
+#include "Compiler.h"
+
+using token::TokenType;
+
+namespace bytecode {
+
+void Compiler::compile(expr::Expr* expression) {
+    spine.clear(); // whatever a CompileError left behind
+    visit(expression);
+    emit(OpCode::PRINT);
+    popped();
+}
+
+void Compiler::finish() {
+    emit(OpCode::RETURN);
+}
+
+void Compiler::pushed(uint32_t count) {
+    depth += count;
+    if (depth > chunk.maxStack) chunk.maxStack = depth;
+}
+
+void Compiler::emitIndexed(OpCode op, uint32_t index) {
+    if (index > MAX_INDEX) throw CompileError(offset, "Too many constants in one chunk");
+    emit(op);
+    chunk.write(static_cast<uint8_t>(index & 0xFF), offset);
+    chunk.write(static_cast<uint8_t>((index >> 8) & 0xFF), offset);
+    chunk.write(static_cast<uint8_t>((index >> 16) & 0xFF), offset);
+}
+
+void Compiler::emitConstant(Value value) {
+    emitConstant(chunk.addConstant(value));
+}
+
+void Compiler::emitConstant(uint32_t index) {
+    if (index <= UINT8_MAX) {
+        emit(OpCode::CONSTANT);
+        chunk.write(static_cast<uint8_t>(index), offset);
+    } else {
+        emitIndexed(OpCode::CONSTANT_LONG, index);
+    }
+    pushed();
+}
+
+uint32_t Compiler::symbolConstant(symbol::Symbol symbol) {
+    auto [slot, inserted] = symbolConstants.try_emplace(symbol.id(), 0);
+    if (inserted) slot->second = chunk.addConstant(Value(heap.borrowString(symbol.view())));
+    return slot->second;
+}
+
+uint32_t Compiler::numberConstant(Value value) {
+    auto [slot, inserted] = numberConstants.try_emplace(value.raw(), 0);
+    if (inserted) slot->second = chunk.addConstant(value);
+    return slot->second;
+}
+
+void Compiler::visitBinaryExpr(expr::Binary* expr) {
+    // A chain is compiled from the innermost operator out, in a loop.
+    size_t base = spine.size();
+    visit(expr::leftSpine(expr, spine));
+    for (size_t i = spine.size(); i-- > base;) binary(spine[i]);
+    spine.resize(base);
+}
+
+void Compiler::binary(expr::Binary* expr) {
+    visit(expr->right);
+    offset = expr->operatorToken.offset;
+    switch (expr->operatorToken.type) {
+        case TokenType::PLUS: emit(OpCode::ADD); break;
+        case TokenType::MINUS: emit(OpCode::SUBTRACT); break;
+        case TokenType::STAR: emit(OpCode::MULTIPLY); break;
+        case TokenType::SLASH: emit(OpCode::DIVIDE); break;
+        case TokenType::EQUAL_EQUAL: emit(OpCode::EQUAL); break;
+        case TokenType::BANG_EQUAL: emit(OpCode::NOT_EQUAL); break;
+        case TokenType::GREATER: emit(OpCode::GREATER); break;
+        case TokenType::GREATER_EQUAL: emit(OpCode::GREATER_EQUAL); break;
+        case TokenType::LESS: emit(OpCode::LESS); break;
+        case TokenType::LESS_EQUAL: emit(OpCode::LESS_EQUAL); break;
+        default: break;
+    }
+    popped();
+}
+
+void Compiler::visitUnaryExpr(expr::Unary* expr) {
+    visit(expr->right);
+    offset = expr->operatorToken.offset;
+    emit(expr->operatorToken.type == TokenType::MINUS ? OpCode::NEGATE : OpCode::NOT);
+}
+
+void Compiler::visitLiteralExpr(expr::Literal* expr) {
+    const TokenValue& value = expr->value;
+    if (std::holds_alternative<int64_t>(value)) {
+        emitConstant(numberConstant(Value::integer(std::get<int64_t>(value))));
+    } else if (std::holds_alternative<double>(value)) {
+        emitConstant(numberConstant(Value(std::get<double>(value))));
+    } else if (std::holds_alternative<symbol::Symbol>(value)) {
+        emitConstant(symbolConstant(std::get<symbol::Symbol>(value)));
+    } else if (std::holds_alternative<string_view>(value)) {
+        emitConstant(Value(heap.borrowString(std::get<string_view>(value))));
+    } else if (std::holds_alternative<bool>(value)) {
+        emit(std::get<bool>(value) ? OpCode::TRUE : OpCode::FALSE);
+        pushed();
+    } else {
+        emit(OpCode::NIL);
+        pushed();
+    }
+}
+
+void Compiler::visitGroupingExpr(expr::Grouping* expr) {
+    visit(expr->expression);
+}
+
+void Compiler::visitVariableExpr(expr::Variable* expr) {
+    offset = expr->offset;
+    emitIndexed(OpCode::GET_GLOBAL, symbolConstant(expr->name));
+    pushed();
+}
+
+} // namespace bytecode
@@ -0,0 +1,231 @@
+#include "ConstantFolder.h"
+
+#include <cmath>
+#include <optional>
+#include <string>
+
+using token::TokenType;
+
+namespace optimizer {
+
+static const TokenValue* literalValue(Expr* expression) {
+    if (expression->kind != expr::ExprKind::LITERAL) return nullptr;
+    return &static_cast<expr::Literal*>(expression)->value;
+}
+
+static bool isNumberLiteral(Expr* expression, double number) {
+    const TokenValue* value = literalValue(expression);
+    if (value == nullptr || !token::isNumber(*value)) return false;
+    double literal = token::numberOf(*value);
+    return literal == number && std::signbit(literal) == std::signbit(number);
+}
+
+// Whether evaluating the expression either fails or yields a number.
+static bool producesNumber(Expr* expression) {
+    switch (expression->kind) {
+        case expr::ExprKind::LITERAL:
+            return token::isNumber(static_cast<expr::Literal*>(expression)->value);
+        case expr::ExprKind::UNARY:
+            return static_cast<expr::Unary*>(expression)->operatorToken.type == TokenType::MINUS;
+        case expr::ExprKind::BINARY: {
+            TokenType type = static_cast<expr::Binary*>(expression)->operatorToken.type;
+            return type == TokenType::MINUS || type == TokenType::STAR || type == TokenType::SLASH;
+        }
+        case expr::ExprKind::GROUPING:
+            return producesNumber(static_cast<expr::Grouping*>(expression)->expression);
+        default:
+            return false;
+    }
+}
+
+// Whether evaluating the expression either fails or yields a boolean.
+static bool producesBool(Expr* expression) {
+    switch (expression->kind) {
+        case expr::ExprKind::LITERAL:
+            return std::holds_alternative<bool>(static_cast<expr::Literal*>(expression)->value);
+        case expr::ExprKind::UNARY:
+            return static_cast<expr::Unary*>(expression)->operatorToken.type == TokenType::BANG;
+        case expr::ExprKind::BINARY:
+            switch (static_cast<expr::Binary*>(expression)->operatorToken.type) {
+                case TokenType::EQUAL_EQUAL:
+                case TokenType::BANG_EQUAL:
+                case TokenType::GREATER:
+                case TokenType::GREATER_EQUAL:
+                case TokenType::LESS:
+                case TokenType::LESS_EQUAL:
+                    return true;
+                default:
+                    return false;
+            }
+        case expr::ExprKind::GROUPING:
+            return producesBool(static_cast<expr::Grouping*>(expression)->expression);
+        default:
+            return false;
+    }
+}
+
+// The interpreter's truthiness and equality, over literal values.
+static bool isTruthy(const TokenValue& value) {
+    if (std::holds_alternative<monostate>(value)) return false;
+    if (std::holds_alternative<bool>(value)) return std::get<bool>(value);
+    return true;
+}
+
+static bool isEqual(const TokenValue& left, const TokenValue& right) {
+    if (std::holds_alternative<symbol::Symbol>(left) && std::holds_alternative<symbol::Symbol>(right)) {
+        return std::get<symbol::Symbol>(left) == std::get<symbol::Symbol>(right);
+    }
+    if (token::isText(left) && token::isText(right)) return token::textOf(left) == token::textOf(right);
+    if (token::isNumber(left) && token::isNumber(right)) return token::numberOf(left) == token::numberOf(right);
+    if (left.index() != right.index()) return false;
+    if (std::holds_alternative<bool>(left)) return std::get<bool>(left) == std::get<bool>(right);
+    return true; // nil == nil
+}
+
+// A computed number, kept as an integer literal when both operands were
+// integers and the result is one, as it would be at runtime.
+static TokenValue number(double value, bool integers) {
+    constexpr double EXACT_LIMIT = 9007199254740992.0; // 2^53
+    if (integers && value == std::trunc(value) && std::fabs(value) < EXACT_LIMIT && !(value == 0 && std::signbit(value))) {
+        return TokenValue(static_cast<int64_t>(value));
+    }
+    return TokenValue(value);
+}
+
+Expr* ConstantFolder::child(Expr* expression) {
+    if (!shared) return visit(expression);
+    if (auto found = folded.find(expression); found != folded.end()) return found->second;
+    Expr* result = visit(expression);
+    folded.emplace(expression, result);
+    return result;
+}
+
+Expr* ConstantFolder::literal(TokenValue value) {
+    return arena.make<expr::Literal>(value);
+}
+
+Expr* ConstantFolder::visitBinaryExpr(expr::Binary* expr) {
+    // A chain is folded from the innermost operator out, in a loop. With
+    // `shared`, the walk down stops at a node that was already folded.
+    size_t base = spine.size();
+    Expr* node = expr;
+    do {
+        spine.push_back(static_cast<expr::Binary*>(node));
+        node = static_cast<expr::Binary*>(node)->left;
+    } while (node->kind == expr::ExprKind::BINARY && !(shared && folded.contains(node)));
+    Expr* left = child(node);
+    for (size_t i = spine.size(); i-- > base;) {
+        Expr* original = spine[i];
+        left = binary(spine[i], left);
+        if (shared && i > base) folded.emplace(original, left);
+    }
+    spine.resize(base);
+    return left;
+}
+
+Expr* ConstantFolder::binary(expr::Binary* expr, Expr* foldedLeft) {
+    Expr* foldedRight = child(expr->right);
+    if (!shared) {
+        expr->left = foldedLeft;
+        expr->right = foldedRight;
+    } else if (foldedLeft != expr->left || foldedRight != expr->right) {
+        expr = arena.make<expr::Binary>(foldedLeft, expr->operatorToken, foldedRight);
+    }
+    TokenType type = expr->operatorToken.type;
+
+    const TokenValue* left = literalValue(expr->left);
+    const TokenValue* right = literalValue(expr->right);
+    if (left != nullptr && right != nullptr) {
+        std::optional<TokenValue> result;
+        bool numbers = token::isNumber(*left) && token::isNumber(*right);
+        bool integers = std::holds_alternative<int64_t>(*left) && std::holds_alternative<int64_t>(*right);
+        double a = numbers ? token::numberOf(*left) : 0;
+        double b = numbers ? token::numberOf(*right) : 0;
+        switch (type) {
+            case TokenType::PLUS:
+                if (numbers) {
+                    result = number(a + b, integers);
+                } else if (token::isText(*left) && token::isText(*right)) {
+                    std::string joined(token::textOf(*left));
+                    joined += token::textOf(*right);
+                    result = symbol::intern(joined);
+                }
+                break;
+            case TokenType::MINUS: if (numbers) result = number(a - b, integers); break;
+            case TokenType::STAR: if (numbers) result = number(a * b, integers); break;
+            case TokenType::SLASH: if (numbers) result = number(a / b, integers); break;
+            case TokenType::GREATER: if (numbers) result = a > b; break;
+            case TokenType::GREATER_EQUAL: if (numbers) result = a >= b; break;
+            case TokenType::LESS: if (numbers) result = a < b; break;
+            case TokenType::LESS_EQUAL: if (numbers) result = a <= b; break;
+            case TokenType::EQUAL_EQUAL: result = isEqual(*left, *right); break;
+            case TokenType::BANG_EQUAL: result = !isEqual(*left, *right); break;
+            default: break;
+        }
+        // No result means a runtime type error, which is left for runtime to report.
+        if (!result) return expr;
+        counts.foldedNodes++;
+        return literal(*result);
+    }
+
+    Expr* kept = nullptr;
+    if (type == TokenType::STAR && isNumberLiteral(expr->right, 1) && producesNumber(expr->left)) kept = expr->left;
+    else if (type == TokenType::STAR && isNumberLiteral(expr->left, 1) && producesNumber(expr->right)) kept = expr->right;
+    else if (type == TokenType::SLASH && isNumberLiteral(expr->right, 1) && producesNumber(expr->left)) kept = expr->left;
+    else if (type == TokenType::MINUS && isNumberLiteral(expr->right, 0) && producesNumber(expr->left)) kept = expr->left;
+    if (kept != nullptr) {
+        counts.simplifiedNodes += 2; // the operator and the literal operand
+        return kept;
+    }
+    return expr;
+}
+
+Expr* ConstantFolder::visitUnaryExpr(expr::Unary* expr) {
+    Expr* foldedRight = child(expr->right);
+    if (!shared) {
+        expr->right = foldedRight;
+    } else if (foldedRight != expr->right) {
+        expr = arena.make<expr::Unary>(expr->operatorToken, foldedRight);
+    }
+    TokenType type = expr->operatorToken.type;
+
+    if (const TokenValue* value = literalValue(expr->right)) {
+        if (type == TokenType::MINUS && token::isNumber(*value)) {
+            counts.foldedNodes++;
+            return literal(number(-token::numberOf(*value), std::holds_alternative<int64_t>(*value)));
+        }
+        if (type == TokenType::BANG) {
+            counts.foldedNodes++;
+            return literal(!isTruthy(*value));
+        }
+        return expr;
+    }
+
+    if (expr->right->kind == expr::ExprKind::UNARY) {
+        auto* inner = static_cast<expr::Unary*>(expr->right);
+        bool doubleNegation = type == TokenType::MINUS && inner->operatorToken.type == TokenType::MINUS
+            && producesNumber(inner->right);
+        bool doubleNot = type == TokenType::BANG && inner->operatorToken.type == TokenType::BANG
+            && producesBool(inner->right);
+        if (doubleNegation || doubleNot) {
+            counts.simplifiedNodes += 2;
+            return inner->right;
+        }
+    }
+    return expr;
+}
+
+Expr* ConstantFolder::visitLiteralExpr(expr::Literal* expr) {
+    return expr;
+}
+
+Expr* ConstantFolder::visitGroupingExpr(expr::Grouping* expr) {
+    counts.strippedGroupings++;
+    return child(expr->expression);
+}
+
+Expr* ConstantFolder::visitVariableExpr(expr::Variable* expr) {
+    return expr;
+}
+
+} // namespace optimizer
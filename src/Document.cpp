@@ -0,0 +1,339 @@
+#include "Document.h"
+
+#include <algorithm>
+
+#include "Keywords.h"
+#include "Parser.h"
+#include "Scanner.h"
+#include "TokenSource.h"
+
+using std::unique_ptr;
+using std::vector;
+using token::TokenType;
+using token::TokenValue;
+
+namespace incremental {
+
+namespace {
+
+    // Segments are usually a line or two, so their arenas start small.
+    constexpr size_t SEGMENT_ARENA_CHUNK = 1024;
+    constexpr size_t SCANNER_LOOKAHEAD = 2;
+
+    struct Lexed {
+        vector<Token> tokens;     // offsets into the window, lexemes detached from it
+        diagnostics::Diagnostics errors; // one per NONE token, in order
+        bool resynced = true;     // a token starts exactly at the window's end
+        TokenType following = TokenType::END_OF_FILE; // type of that token
+    };
+
+    // Operators that would continue an expression that precedes them.
+    bool continuesExpression(TokenType type) {
+        switch (type) {
+            case TokenType::PLUS: case TokenType::MINUS: case TokenType::STAR: case TokenType::SLASH:
+            case TokenType::EQUAL_EQUAL: case TokenType::BANG_EQUAL:
+            case TokenType::GREATER: case TokenType::GREATER_EQUAL:
+            case TokenType::LESS: case TokenType::LESS_EQUAL:
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    // Views into the window are swapped for the fixed spelling of the token
+    // type, so tokens stay valid once the window is gone. Identifiers and
+    // strings are interned symbols already.
+    Token detach(Token token) {
+        if (std::holds_alternative<string_view>(token.lexeme)) {
+            string_view fixed = token::spelling(token.type);
+            if (fixed.empty()) fixed = scanner::keywordSpelling(token.type);
+            token.lexeme = TokenValue(fixed);
+        }
+        return token;
+    }
+
+    // Lexes `window` and then as much of `lookahead` (the text right after
+    // it) as it takes to see whether a token starts exactly where the window
+    // ends. If one does, lexing the rest of the document from there gives
+    // the tokens it had before the edit.
+    Lexed lex(string_view window, string_view lookahead) {
+        string text;
+        text.reserve(window.size() + lookahead.size());
+        text.append(window).append(lookahead);
+
+        Lexed lexed;
+        scanner::Scanner scanner(text, lexed.errors);
+        for (const Token& token : scanner) {
+            if (token.offset >= window.size()) {
+                lexed.resynced = token.offset == window.size();
+                lexed.following = token.type;
+                return lexed;
+            }
+            if (token.end() > window.size()) {
+                lexed.resynced = false;
+                return lexed;
+            }
+            lexed.tokens.push_back(detach(token));
+        }
+        lexed.resynced = lookahead.empty();
+        return lexed;
+    }
+
+    // Feeds the parser the window's tokens from `first` on, rebased so the
+    // segment being parsed starts at offset 0.
+    class WindowTokens : public parser::TokenSource {
+    public:
+        WindowTokens(const vector<Token>& tokens, size_t first, uint32_t base, uint32_t end)
+            : tokens(tokens), index(first), base(base), end(end) {}
+
+        Token next() override {
+            if (index < tokens.size()) {
+                Token token = tokens[index++];
+                token.offset -= base;
+                return token;
+            }
+            return Token(TokenType::END_OF_FILE, TokenValue(), end - base);
+        }
+
+        size_t position() const { return index; }
+
+    private:
+        const vector<Token>& tokens;
+        size_t index;
+        uint32_t base;
+        uint32_t end;
+    };
+
+    bool isBlank(char c) {
+        return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+    }
+
+    int countNewlines(string_view text) {
+        return static_cast<int>(std::count(text.begin(), text.end(), '\n'));
+    }
+
+    // Splits the lexed window into segments, one per top-level expression.
+    vector<unique_ptr<Segment>> parse(string_view window, const Lexed& lexed) {
+        vector<unique_ptr<Segment>> built;
+        size_t index = 0;
+        size_t errorIndex = 0;
+        size_t start = 0;
+        while (index < lexed.tokens.size()) {
+            auto segment = std::make_unique<Segment>();
+            segment->arena = std::make_unique<expr::AstArena>(SEGMENT_ARENA_CHUNK);
+            uint32_t base = static_cast<uint32_t>(start);
+            WindowTokens source(lexed.tokens, index, base, static_cast<uint32_t>(window.size()));
+            parser::Parser parser(source, *segment->arena, window.substr(start));
+            size_t count;
+            try {
+                segment->root = parser.next();
+                count = parser.consumed();
+            } catch (const parser::ParseError& error) {
+                segment->error = error.what();
+                segment->errorOffset = error.token.offset;
+                segment->errorAtEnd = error.token.type == TokenType::END_OF_FILE;
+                // The segment runs up to and including the token the parser
+                // stopped at, or to the end if that was the end.
+                count = segment->errorAtEnd ? lexed.tokens.size() - index : source.position() - index;
+            }
+
+            for (size_t i = index; i < index + count; i++) {
+                Token token = lexed.tokens[i];
+                token.offset -= base;
+                if (token.type == TokenType::NONE) {
+                    Diagnostic error = lexed.errors[errorIndex++];
+                    error.offset = token.offset;
+                    segment->lexicalErrors.push_back(std::move(error));
+                }
+                segment->tokens.push_back(token);
+            }
+            index += count;
+
+            size_t end = index < lexed.tokens.size() ? lexed.tokens[index].offset : window.size();
+            segment->text = window.substr(start, end - start);
+            segment->newlines = countNewlines(segment->text);
+            start = end;
+            built.push_back(std::move(segment));
+        }
+        if (built.empty() && !window.empty()) {
+            // Only blanks and comments.
+            auto segment = std::make_unique<Segment>();
+            segment->text = window;
+            segment->newlines = countNewlines(window);
+            built.push_back(std::move(segment));
+        }
+        return built;
+    }
+
+    // Whether two segments hold the same tokens and errors, so the one
+    // already built (and its tree) can stand for the other.
+    bool sameExpression(const Segment& a, const Segment& b) {
+        if (a.tokens.size() != b.tokens.size() || a.lexicalErrors.size() != b.lexicalErrors.size()) return false;
+        if (a.error != b.error || a.errorOffset != b.errorOffset || a.errorAtEnd != b.errorAtEnd) return false;
+        for (size_t i = 0; i < a.tokens.size(); i++) {
+            const Token& x = a.tokens[i];
+            const Token& y = b.tokens[i];
+            if (x.type != y.type || x.offset != y.offset || x.length != y.length || x.lexeme != y.lexeme) return false;
+        }
+        for (size_t i = 0; i < a.lexicalErrors.size(); i++) {
+            if (a.lexicalErrors[i].offset != b.lexicalErrors[i].offset
+                || a.lexicalErrors[i].message != b.lexicalErrors[i].message) return false;
+        }
+        return true;
+    }
+
+    void retext(Segment& kept, Segment& built) {
+        kept.text = std::move(built.text);
+        kept.newlines = built.newlines;
+    }
+
+} // namespace
+
+Document::Document(string_view text) {
+    if (!text.empty()) edit(0, 0, text);
+}
+
+string Document::text() const {
+    string joined;
+    joined.reserve(length);
+    for (const auto& segment : segments) joined += segment->text;
+    return joined;
+}
+
+size_t Document::offset(size_t index) const {
+    size_t start = 0;
+    for (size_t i = 0; i < index; i++) start += segments[i]->text.size();
+    return start;
+}
+
+int Document::firstLine(size_t index) const {
+    int line = 1 + sealedLines;
+    for (size_t i = 0; i < index; i++) line += segments[i]->newlines;
+    return line;
+}
+
+source::Position Document::position(size_t index, uint32_t offset) const {
+    const string& text = segments[index]->text;
+    offset = std::min(offset, static_cast<uint32_t>(text.size()));
+    int line = firstLine(index) + static_cast<int>(std::count(text.begin(), text.begin() + offset, '\n'));
+    // The column counts back to the last newline, which may be in an
+    // earlier segment when several expressions share a line.
+    size_t newline = offset == 0 ? string::npos : text.rfind('\n', offset - 1);
+    size_t column = newline == string::npos ? offset : offset - newline - 1;
+    for (size_t i = index; newline == string::npos && i-- > 0;) {
+        const string& before = segments[i]->text;
+        newline = before.rfind('\n');
+        column += newline == string::npos ? before.size() : before.size() - newline - 1;
+    }
+    if (newline == string::npos) column += sealedColumn;
+    return source::Position { line, static_cast<int>(column + 1) };
+}
+
+vector<Diagnostic> Document::diagnostics(size_t index) const {
+    const Segment& segment = *segments[index];
+    uint32_t start = static_cast<uint32_t>(offset(index));
+    vector<Diagnostic> found = segment.lexicalErrors;
+    if (!segment.error.empty()) found.push_back({ diagnostics::Stage::SYNTAX, segment.errorOffset, segment.error });
+    for (Diagnostic& error : found) {
+        source::Position position = this->position(index, error.offset);
+        error.offset += start;
+        error.line = position.line;
+        error.column = position.column;
+    }
+    return found;
+}
+
+void Document::seal(size_t count) {
+    count = std::min(count, segments.size());
+    for (size_t i = 0; i < count; i++) {
+        const string& text = segments[i]->text;
+        size_t newline = text.rfind('\n');
+        sealedColumn = newline == string::npos ? sealedColumn + text.size() : text.size() - newline - 1;
+        sealedLines += segments[i]->newlines;
+        length -= text.size();
+    }
+    segments.erase(segments.begin(), segments.begin() + count);
+}
+
+EditResult Document::edit(size_t offset, size_t removedLength, string_view replacement) {
+    offset = std::min(offset, length);
+    removedLength = std::min(removedLength, length - offset);
+
+    // The segments holding the first and last edited byte, found by adding
+    // up lengths only as far as the edit goes, and where the first starts.
+    size_t first = 0;
+    size_t last = 0;
+    size_t firstStart = 0;
+    size_t editEnd = offset + (removedLength > 0 ? removedLength - 1 : 0);
+    for (size_t i = 0, start = 0; i < segments.size() && start <= editEnd; start += segments[i++]->text.size()) {
+        if (start <= offset) {
+            first = i;
+            firstStart = start;
+        }
+        last = i;
+    }
+    // The segment before may continue into the edit (or be continued by it).
+    if (first > 0) firstStart -= segments[--first]->text.size();
+
+    vector<unique_ptr<Segment>> built;
+    while (true) {
+        size_t end = segments.empty() ? 0 : last + 1; // one past the window's segments
+        string window;
+        for (size_t i = first; i < end; i++) window += segments[i]->text;
+        window.replace(offset - firstStart, removedLength, replacement);
+        // The scanner looks up to two characters past a token ("1." + digit),
+        // so a one-character segment after the window is not enough.
+        string lookahead;
+        for (size_t i = end; i < segments.size() && lookahead.size() < SCANNER_LOOKAHEAD; i++) {
+            lookahead += segments[i]->text;
+        }
+
+        Lexed lexed = lex(window, lookahead);
+        built = parse(window, lexed);
+
+        bool widenForward = !lexed.resynced
+            || (lexed.tokens.empty() && end < segments.size())
+            || (!built.empty() && built.back()->errorAtEnd && end < segments.size())
+            || (!built.empty() && built.back()->root != nullptr && continuesExpression(lexed.following));
+        // The segment before the window ended where it did because of the
+        // type of the token that starts the window, so that token must
+        // survive, and a token ending right at the window could now run on
+        // into it ("1" "." + "5").
+        bool widenBack = first > 0
+            && (lexed.tokens.empty() || lexed.tokens.front().offset != 0
+                || lexed.tokens.front().type != segments[first]->tokens.front().type
+                || !isBlank(segments[first - 1]->text.back()));
+        if (widenBack) {
+            firstStart -= segments[--first]->text.size();
+        } else if (widenForward && end < segments.size()) {
+            last++;
+        } else {
+            break;
+        }
+    }
+
+    // Keep the segments that came out the same at either end of the window,
+    // trees included; only their trailing blanks and comments may differ.
+    size_t end = segments.empty() ? 0 : last + 1;
+    size_t front = 0;
+    while (front < built.size() && first + front < end && sameExpression(*built[front], *segments[first + front])) {
+        retext(*segments[first + front], *built[front]);
+        front++;
+    }
+    size_t back = 0;
+    while (back < built.size() - front && end - back > first + front
+           && sameExpression(*built[built.size() - 1 - back], *segments[end - 1 - back])) {
+        retext(*segments[end - 1 - back], *built[built.size() - 1 - back]);
+        back++;
+    }
+
+    EditResult result { first + front, end - first - front - back, built.size() - front - back };
+    segments.erase(segments.begin() + result.first, segments.begin() + result.first + result.removed);
+    segments.insert(segments.begin() + result.first,
+                    std::make_move_iterator(built.begin() + front),
+                    std::make_move_iterator(built.end() - back));
+    length = length - removedLength + replacement.size();
+    return result;
+}
+
+} // namespace incremental
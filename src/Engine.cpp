@@ -0,0 +1,94 @@
+#include "Engine.h"
+
+#include "Compiler.h"
+#include "ConstantFolder.h"
+#include "Interpreter.h"
+#include "OutputSink.h"
+#include "Parser.h"
+#include "Scanner.h"
+#include "Source.h"
+#include "VM.h"
+
+using diagnostics::Stage;
+using std::vector;
+
+namespace engine {
+
+// Offsets are 32-bit, so a longer script could only be misreported.
+static bool tooLarge(string_view source, diagnostics::Diagnostics& errors) {
+    if (source.size() <= source::MAX_SOURCE_SIZE) return false;
+    errors.report(Stage::INTERNAL, 0, "Script too large (the limit is 4 GiB)");
+    return true;
+}
+
+vector<Token> Engine::scan(string_view source, diagnostics::Diagnostics& errors) {
+    symbols.clear();
+    symbol::Scope scope(symbols);
+    if (tooLarge(source, errors)) return {};
+    scanner::Scanner scanner(source, errors);
+    vector<Token> tokens;
+    auto it = scanner.begin();
+    for (; it != scanner.end(); ++it) tokens.push_back(*it);
+    tokens.push_back(*it); // END_OF_FILE
+    errors.locate(source::LineIndex(source));
+    return tokens;
+}
+
+vector<expr::Expr*> Engine::parse(string_view source, diagnostics::Diagnostics& errors) {
+    arena.reset();
+    symbols.clear();
+    symbol::Scope scope(symbols);
+    if (tooLarge(source, errors)) return {};
+    scanner::Scanner scanner(source, errors);
+    parser::Parser parser(scanner, arena);
+    optimizer::ConstantFolder folder(arena);
+    vector<expr::Expr*> roots;
+    while (expr::Expr* root = parser.next(errors)) {
+        roots.push_back(options.fold ? folder.fold(root) : root);
+    }
+    errors.locate(source::LineIndex(source));
+    return roots;
+}
+
+Result Engine::run(string_view source) {
+    diagnostics::Diagnostics errors;
+    vector<expr::Expr*> roots = parse(source, errors);
+    Result result;
+    if (!errors.empty()) {
+        result.diagnostics = errors.take();
+        return result;
+    }
+
+    runtime::Heap heap;
+    output::OutputSink out;
+    if (options.vm) {
+        chunk.clear();
+        bytecode::Compiler compiler(chunk, heap);
+        try {
+            for (expr::Expr* root : roots) compiler.compile(root);
+            compiler.finish();
+            vm::VM machine(heap, out);
+            if (machine.run(chunk) == vm::InterpretResult::RUNTIME_ERROR) {
+                errors.report(Stage::RUNTIME, machine.errorOffset(), machine.errorMessage());
+            }
+        } catch (const bytecode::CompileError& error) {
+            errors.report(Stage::COMPILE, error.offset, error.what());
+        }
+    } else {
+        interpreter::Interpreter interpreter(heap);
+        try {
+            for (expr::Expr* root : roots) {
+                runtime::printValue(out, interpreter.evaluate(root));
+                out << '\n';
+            }
+        } catch (const interpreter::RuntimeError& error) {
+            errors.report(Stage::RUNTIME, error.token.offset, error.what());
+        }
+    }
+    result.output = out.take();
+    errors.locate(source::LineIndex(source));
+    result.diagnostics = errors.take();
+    return result;
+}
+
+} // namespace engine
@@ -0,0 +1,195 @@
+#include "HashCons.h"
+
+#include <cstring>
+#include <functional>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+
+using token::TokenType;
+
+namespace expr {
+
+namespace {
+
+    size_t mix(size_t seed, uint64_t value) {
+        // The finalizer of splitmix64 over the running hash.
+        uint64_t x = seed ^ (value + 0x9e3779b97f4a7c15 + (seed << 6) + (seed >> 2));
+        x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9;
+        x = (x ^ (x >> 27)) * 0x94d049bb133111eb;
+        return static_cast<size_t>(x ^ (x >> 31));
+    }
+
+    uint64_t doubleBits(double number) {
+        uint64_t bits;
+        std::memcpy(&bits, &number, sizeof(bits));
+        return bits;
+    }
+
+    size_t valueHash(const TokenValue& value) {
+        size_t hash = value.index();
+        if (std::holds_alternative<string_view>(value)) return mix(hash, std::hash<string_view>()(std::get<string_view>(value)));
+        if (std::holds_alternative<double>(value)) return mix(hash, doubleBits(std::get<double>(value)));
+        if (std::holds_alternative<int64_t>(value)) return mix(hash, static_cast<uint64_t>(std::get<int64_t>(value)));
+        if (std::holds_alternative<bool>(value)) return mix(hash, std::get<bool>(value));
+        if (std::holds_alternative<symbol::Symbol>(value)) return mix(hash, std::get<symbol::Symbol>(value).id());
+        return mix(hash, 0);
+    }
+
+    // Doubles compare by bits, so 0 and -0 stay apart.
+    bool sameValue(const TokenValue& a, const TokenValue& b) {
+        if (a.index() != b.index()) return false;
+        if (std::holds_alternative<double>(a)) return doubleBits(std::get<double>(a)) == doubleBits(std::get<double>(b));
+        return a == b;
+    }
+
+    TokenType operatorOf(Expr* expr) {
+        switch (expr->kind) {
+            case ExprKind::BINARY: return static_cast<Binary*>(expr)->operatorToken.type;
+            case ExprKind::UNARY: return static_cast<Unary*>(expr)->operatorToken.type;
+            default: return TokenType::NONE;
+        }
+    }
+
+    // One node's hash, given how to hash its children.
+    template <typename ChildHash>
+    size_t nodeHash(Expr* expr, ChildHash child) {
+        size_t hash = mix(static_cast<size_t>(expr->kind), static_cast<uint64_t>(operatorOf(expr)));
+        switch (expr->kind) {
+            case ExprKind::BINARY: {
+                auto binary = static_cast<Binary*>(expr);
+                return mix(mix(hash, child(binary->left)), child(binary->right));
+            }
+            case ExprKind::UNARY: return mix(hash, child(static_cast<Unary*>(expr)->right));
+            case ExprKind::GROUPING: return mix(hash, child(static_cast<Grouping*>(expr)->expression));
+            case ExprKind::LITERAL: return mix(hash, valueHash(static_cast<Literal*>(expr)->value));
+            case ExprKind::VARIABLE: return mix(hash, static_cast<Variable*>(expr)->name.id());
+        }
+        std::unreachable();
+    }
+
+    // Whether two nodes are alike, given how to compare their children.
+    template <typename ChildEqual>
+    bool nodeEqual(Expr* a, Expr* b, ChildEqual children) {
+        if (a->kind != b->kind || operatorOf(a) != operatorOf(b)) return false;
+        switch (a->kind) {
+            case ExprKind::BINARY: {
+                auto x = static_cast<Binary*>(a), y = static_cast<Binary*>(b);
+                return children(x->left, y->left) && children(x->right, y->right);
+            }
+            case ExprKind::UNARY: return children(static_cast<Unary*>(a)->right, static_cast<Unary*>(b)->right);
+            case ExprKind::GROUPING:
+                return children(static_cast<Grouping*>(a)->expression, static_cast<Grouping*>(b)->expression);
+            case ExprKind::LITERAL: return sameValue(static_cast<Literal*>(a)->value, static_cast<Literal*>(b)->value);
+            case ExprKind::VARIABLE: return static_cast<Variable*>(a)->name == static_cast<Variable*>(b)->name;
+        }
+        std::unreachable();
+    }
+
+    size_t shallowHash(Expr* expr) {
+        return nodeHash(expr, [](Expr* child) { return reinterpret_cast<uintptr_t>(child); });
+    }
+
+    bool shallowEqual(Expr* a, Expr* b) {
+        return nodeEqual(a, b, [](Expr* x, Expr* y) { return x == y; });
+    }
+
+    using HashMemo = std::unordered_map<Expr*, size_t>;
+
+    struct PairHash {
+        size_t operator()(const std::pair<Expr*, Expr*>& pair) const {
+            return mix(reinterpret_cast<uintptr_t>(pair.first), reinterpret_cast<uintptr_t>(pair.second));
+        }
+    };
+
+    // The pairs already found equal. A pair found unequal ends the whole
+    // comparison, so it never needs remembering.
+    using EqualMemo = std::unordered_set<std::pair<Expr*, Expr*>, PairHash>;
+
+    bool isLeaf(Expr* expr) {
+        return expr->kind == ExprKind::LITERAL || expr->kind == ExprKind::VARIABLE;
+    }
+
+    // Leaves are cheaper to hash or compare again than to look up, so only
+    // operators and groupings are memoized.
+    size_t memoizedHash(Expr* expr, HashMemo& memo) {
+        if (isLeaf(expr)) return nodeHash(expr, [](Expr*) { return size_t(0); });
+        if (auto found = memo.find(expr); found != memo.end()) return found->second;
+        // Down a chain of left operands in a loop, then hash it bottom-up,
+        // so each left child is already memoized when its parent is hashed.
+        std::vector<Expr*> spine { expr };
+        while (spine.back()->kind == ExprKind::BINARY) {
+            Expr* left = static_cast<Binary*>(spine.back())->left;
+            if (left->kind != ExprKind::BINARY || memo.contains(left)) break;
+            spine.push_back(left);
+        }
+        size_t hash = 0;
+        for (size_t i = spine.size(); i-- > 0;) {
+            hash = nodeHash(spine[i], [&](Expr* child) { return memoizedHash(child, memo); });
+            memo.emplace(spine[i], hash);
+        }
+        return hash;
+    }
+
+    bool memoizedEqual(Expr* a, Expr* b, EqualMemo& memo) {
+        if (a == b) return true;
+        if (isLeaf(a) || isLeaf(b)) return nodeEqual(a, b, [](Expr*, Expr*) { return false; });
+        if (memo.contains({ a, b })) return true;
+        // As in memoizedHash(), the left edges are walked in a loop.
+        std::vector<std::pair<Expr*, Expr*>> spine { { a, b } };
+        while (spine.back().first->kind == ExprKind::BINARY && spine.back().second->kind == ExprKind::BINARY) {
+            Expr* x = static_cast<Binary*>(spine.back().first)->left;
+            Expr* y = static_cast<Binary*>(spine.back().second)->left;
+            if (x == y || x->kind != ExprKind::BINARY || y->kind != ExprKind::BINARY || memo.contains({ x, y })) break;
+            spine.push_back({ x, y });
+        }
+        auto children = [&](Expr* x, Expr* y) { return memoizedEqual(x, y, memo); };
+        for (size_t i = spine.size(); i-- > 0;) {
+            if (!nodeEqual(spine[i].first, spine[i].second, children)) return false;
+            memo.insert(spine[i]);
+        }
+        return true;
+    }
+
+} // namespace
+
+size_t structuralHash(Expr* expr) {
+    HashMemo memo;
+    return memoizedHash(expr, memo);
+}
+
+bool structurallyEqual(Expr* a, Expr* b) {
+    EqualMemo memo;
+    return memoizedEqual(a, b, memo);
+}
+
+Expr* HashConsBuilder::intern(AstArena::Mark mark, Expr* candidate) {
+    requested++;
+    if (2 * (count + 1) > slots.size()) grow();
+    size_t mask = slots.size() - 1;
+    for (size_t i = shallowHash(candidate) & mask;; i = (i + 1) & mask) {
+        if (slots[i] == nullptr) {
+            slots[i] = candidate;
+            count++;
+            return candidate;
+        }
+        if (shallowEqual(slots[i], candidate)) {
+            arena.rewind(mark);
+            return slots[i];
+        }
+    }
+}
+
+void HashConsBuilder::grow() {
+    std::vector<Expr*> old(slots.empty() ? 1024 : 2 * slots.size(), nullptr);
+    old.swap(slots);
+    size_t mask = slots.size() - 1;
+    for (Expr* node : old) {
+        if (node == nullptr) continue;
+        size_t i = shallowHash(node) & mask;
+        while (slots[i] != nullptr) i = (i + 1) & mask;
+        slots[i] = node;
+    }
+}
+
+} // namespace expr
@@ -0,0 +1,99 @@
+#include "Interpreter.h"
+
+using token::TokenType;
+
+namespace interpreter {
+
+static void checkNumberOperand(const Token& operatorToken, Value operand) {
+    if (operand.isNumber()) return;
+    throw RuntimeError(operatorToken, "Operand must be a number.");
+}
+
+static void checkNumberOperands(const Token& operatorToken, Value left, Value right) {
+    if (left.isNumber() && right.isNumber()) return;
+    throw RuntimeError(operatorToken, "Operands must be numbers.");
+}
+
+Value Interpreter::visitBinaryExpr(expr::Binary* expr) {
+    if (expr->left->kind != expr::ExprKind::BINARY) return binary(expr, visit(expr->left));
+    // A chain: from the innermost operator out, in a loop.
+    size_t base = spine.size();
+    Value left = visit(expr::leftSpine(expr, spine));
+    for (size_t i = spine.size(); i-- > base;) left = binary(spine[i], left);
+    spine.resize(base);
+    return left;
+}
+
+Value Interpreter::binary(expr::Binary* expr, Value left) {
+    Value right = visit(expr->right);
+    const Token& operatorToken = expr->operatorToken;
+
+    switch (operatorToken.type) {
+        case TokenType::PLUS:
+            if (left.isNumber() && right.isNumber()) return runtime::add(left, right);
+            if (left.isString() && right.isString()) {
+                return Value(heap.concatenate(left.asString()->chars, right.asString()->chars));
+            }
+            throw RuntimeError(operatorToken, "Operands must be two numbers or two strings.");
+        case TokenType::MINUS:
+            checkNumberOperands(operatorToken, left, right);
+            return runtime::subtract(left, right);
+        case TokenType::STAR:
+            checkNumberOperands(operatorToken, left, right);
+            return runtime::multiply(left, right);
+        case TokenType::SLASH:
+            checkNumberOperands(operatorToken, left, right);
+            return runtime::divide(left, right);
+        case TokenType::GREATER:
+            checkNumberOperands(operatorToken, left, right);
+            return Value(runtime::less(right, left));
+        case TokenType::GREATER_EQUAL:
+            checkNumberOperands(operatorToken, left, right);
+            return Value(runtime::lessEqual(right, left));
+        case TokenType::LESS:
+            checkNumberOperands(operatorToken, left, right);
+            return Value(runtime::less(left, right));
+        case TokenType::LESS_EQUAL:
+            checkNumberOperands(operatorToken, left, right);
+            return Value(runtime::lessEqual(left, right));
+        case TokenType::EQUAL_EQUAL:
+            return Value(left == right);
+        case TokenType::BANG_EQUAL:
+            return Value(!(left == right));
+        default:
+            throw RuntimeError(operatorToken, "Unknown binary operator.");
+    }
+}
+
+Value Interpreter::visitUnaryExpr(expr::Unary* expr) {
+    Value right = visit(expr->right);
+    switch (expr->operatorToken.type) {
+        case TokenType::MINUS:
+            checkNumberOperand(expr->operatorToken, right);
+            return runtime::negate(right);
+        case TokenType::BANG:
+            return Value(!right.isTruthy());
+        default:
+            throw RuntimeError(expr->operatorToken, "Unknown unary operator.");
+    }
+}
+
+Value Interpreter::visitLiteralExpr(expr::Literal* expr) {
+    const TokenValue& value = expr->value;
+    if (std::holds_alternative<int64_t>(value)) return Value::integer(std::get<int64_t>(value));
+    if (std::holds_alternative<double>(value)) return Value(std::get<double>(value));
+    if (std::holds_alternative<bool>(value)) return Value(std::get<bool>(value));
+    if (token::isText(value)) return Value(heap.borrowString(token::textOf(value)));
+    return Value::nil();
+}
+
+Value Interpreter::visitGroupingExpr(expr::Grouping* expr) {
+    return visit(expr->expression);
+}
+
+Value Interpreter::visitVariableExpr(expr::Variable* expr) {
+    throw RuntimeError(Token(TokenType::IDENTIFIER, expr->name, expr->offset, static_cast<uint32_t>(expr->name.view().size())),
+                       "Undefined variable '" + string(expr->name.view()) + "'.");
+}
+
+} // namespace interpreter
@@ -0,0 +1,32 @@
+#include "LineIndex.h"
+
+#include <algorithm>
+
+#include "ScanKernels.h"
+
+namespace source {
+
+void LineIndex::build() const {
+    starts.push_back(0);
+    scanner::kernels::findNewlines(text.data(), text.data() + text.size(), starts);
+    // findNewlines() appends where each '\n' is; lines start one byte later.
+    for (size_t i = 1; i < starts.size(); i++) starts[i]++;
+}
+
+Position LineIndex::position(uint32_t offset) const {
+    if (starts.empty()) build();
+    // Whether the offset comes before the given line (or that line does not exist).
+    auto before = [&](size_t line) { return line >= starts.size() || offset < starts[line]; };
+    size_t line;
+    if (offset >= starts[recent] && before(recent + 1)) {
+        line = recent;
+    } else if (recent + 1 < starts.size() && offset >= starts[recent + 1] && before(recent + 2)) {
+        line = recent + 1;
+    } else {
+        line = std::upper_bound(starts.begin(), starts.end(), offset) - starts.begin() - 1;
+    }
+    recent = line;
+    return Position { static_cast<int>(line + 1), static_cast<int>(offset - starts[line] + 1) };
+}
+
+} // namespace source
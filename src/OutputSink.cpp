@@ -0,0 +1,73 @@
+#include "OutputSink.h"
+
+#include <charconv>
+#include <cmath>
+
+namespace output {
+
+    OutputSink& OutputSink::operator<<(int64_t number) {
+        char digits[24];
+        auto result = std::to_chars(digits, digits + sizeof(digits), number);
+        return *this << string_view(digits, result.ptr - digits);
+    }
+
+    OutputSink& OutputSink::operator<<(size_t number) {
+        char digits[24];
+        auto result = std::to_chars(digits, digits + sizeof(digits), number);
+        return *this << string_view(digits, result.ptr - digits);
+    }
+
+    OutputSink& OutputSink::fixed(double number) {
+        // Large enough for DBL_MAX printed with six decimals.
+        char digits[320];
+        auto result = std::to_chars(digits, digits + sizeof(digits), number, std::chars_format::fixed, 6);
+        return *this << string_view(digits, result.ptr - digits);
+    }
+
+    OutputSink& OutputSink::general(double number) {
+        char digits[32];
+        auto result = std::to_chars(digits, digits + sizeof(digits), number, std::chars_format::general, 6);
+        return *this << string_view(digits, result.ptr - digits);
+    }
+
+    OutputSink& OutputSink::shortest(double number) {
+        // JSON has no spelling for these.
+        if (!std::isfinite(number)) return *this << "null";
+        char digits[32];
+        auto result = std::to_chars(digits, digits + sizeof(digits), number);
+        return *this << string_view(digits, result.ptr - digits);
+    }
+
+    OutputSink& OutputSink::jsonString(string_view text) {
+        static constexpr char hex[] = "0123456789abcdef";
+        buffer.push_back('"');
+        for (char c : text) {
+            switch (c) {
+                case '"': buffer.append("\\\""); break;
+                case '\\': buffer.append("\\\\"); break;
+                case '\n': buffer.append("\\n"); break;
+                case '\r': buffer.append("\\r"); break;
+                case '\t': buffer.append("\\t"); break;
+                default:
+                    if (static_cast<unsigned char>(c) < 0x20) {
+                        buffer.append("\\u00");
+                        buffer.push_back(hex[(c >> 4) & 0xF]);
+                        buffer.push_back(hex[c & 0xF]);
+                    } else {
+                        buffer.push_back(c);
+                    }
+            }
+        }
+        buffer.push_back('"');
+        maybeFlush();
+        return *this;
+    }
+
+    void OutputSink::flush() {
+        if (file == nullptr || buffer.empty()) return;
+        std::fwrite(buffer.data(), 1, buffer.size(), file);
+        std::fflush(file);
+        buffer.clear();
+    }
+
+} // namespace output
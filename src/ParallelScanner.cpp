@@ -0,0 +1,181 @@
+#include "ParallelScanner.h"
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+
+#include "Diagnostics.h"
+#include "LineIndex.h"
+#include "Scanner.h"
+#include "Stats.h"
+#include "Symbol.h"
+
+using std::vector;
+
+namespace scanner {
+
+namespace {
+
+    // Lexical state at a line start. Comments always end at the newline, so
+    // being inside a string literal is the only state a line start can be in
+    // besides plain code.
+    enum class State { CODE, STRING };
+
+    constexpr size_t NO_RESYNC = static_cast<size_t>(-1);
+
+    struct Walk {
+        State exit;
+        size_t resync = NO_RESYNC;    // first line start reached in CODE state
+    };
+
+    struct ChunkSummary {
+        size_t begin;
+        size_t end;
+        Walk fromCode;
+        Walk fromString;
+    };
+
+    // Follows just enough of the scanner's rules to know where strings and
+    // comments start and end: '"' opens a string outside comments, "//" opens
+    // a comment outside strings, and '\\' escapes the next byte in a string.
+    Walk walk(string_view source, size_t begin, size_t end, State state) {
+        Walk result;
+        bool comment = false;
+        for (size_t i = begin; i < end; i++) {
+            char c = source[i];
+            if (c == '\n') {
+                comment = false;
+                if (state == State::CODE && result.resync == NO_RESYNC && i + 1 < end) result.resync = i + 1;
+                continue;
+            }
+            if (comment) continue;
+            if (state == State::STRING) {
+                if (c == '"') {
+                    state = State::CODE;
+                } else if (c == '\\' && i + 1 < source.size()) {
+                    i++;
+                }
+            } else if (c == '"') {
+                state = State::STRING;
+            } else if (c == '/' && i + 1 < end && source[i + 1] == '/') {
+                comment = true;
+                i++;
+            }
+        }
+        result.exit = state;
+        return result;
+    }
+
+    ChunkSummary summarize(string_view source, size_t begin, size_t end) {
+        return ChunkSummary { begin, end, walk(source, begin, end, State::CODE), walk(source, begin, end, State::STRING) };
+    }
+
+    struct Piece {
+        size_t begin;
+        size_t end;
+        vector<Token> tokens;
+        diagnostics::Diagnostics errors;
+    };
+
+    // The scanner sees the source up to the piece's end and starts at its
+    // beginning, so token offsets come out absolute.
+    void lex(string_view source, Piece& piece) {
+        Scanner scanner(source.substr(0, piece.end), piece.errors, piece.begin);
+        for (const Token& token : scanner) piece.tokens.push_back(token);
+    }
+
+    void report(const Piece& piece, const source::LineIndex& lines, std::ostream& diagnostics) {
+        for (const diagnostics::Diagnostic& error : piece.errors) {
+            diagnostics << error.message << " on " << lines.position(error.offset) << std::endl;
+        }
+    }
+
+} // namespace
+
+vector<Token> scanParallel(string_view source, concurrency::ThreadPool& pool, std::ostream& diagnostics) {
+    size_t chunkCount = pool.size() * 4;
+    if (source.size() / MIN_PARALLEL_CHUNK < chunkCount) chunkCount = source.size() / MIN_PARALLEL_CHUNK;
+
+    // Cut just after the first newline at or past each even split.
+    vector<size_t> cuts { 0 };
+    for (size_t i = 1; i < chunkCount; i++) {
+        size_t target = source.size() / chunkCount * i;
+        if (target < cuts.back()) continue;
+        const void* newline = std::memchr(source.data() + target, '\n', source.size() - target);
+        if (newline == nullptr) break;
+        size_t cut = static_cast<const char*>(newline) - source.data() + 1;
+        if (cut > cuts.back() && cut < source.size()) cuts.push_back(cut);
+    }
+    cuts.push_back(source.size());
+
+    if (cuts.size() == 2) {
+        Piece piece;
+        piece.begin = 0;
+        piece.end = source.size();
+        lex(source, piece);
+        report(piece, source::LineIndex(source), diagnostics);
+        piece.tokens.push_back(Token(TokenType::END_OF_FILE, TokenValue(), static_cast<uint32_t>(source.size())));
+        return std::move(piece.tokens);
+    }
+
+    vector<ChunkSummary> summaries(cuts.size() - 1);
+    for (size_t i = 0; i < summaries.size(); i++) {
+        pool.submit([&, i] { summaries[i] = summarize(source, cuts[i], cuts[i + 1]); });
+    }
+    pool.wait();
+
+    // Decide the real state at each cut and where the pieces begin.
+    vector<std::unique_ptr<Piece>> pieces;
+    State state = State::CODE;
+    for (const ChunkSummary& summary : summaries) {
+        const Walk& walked = state == State::CODE ? summary.fromCode : summary.fromString;
+        size_t begin = state == State::STRING ? walked.resync : summary.begin;
+        if (begin != NO_RESYNC) {
+            if (!pieces.empty()) pieces.back()->end = begin;
+            auto piece = std::make_unique<Piece>();
+            piece->begin = begin;
+            piece->end = summary.end;
+            pieces.push_back(std::move(piece));
+        } else {
+            pieces.back()->end = summary.end;
+        }
+        state = walked.exit;
+    }
+
+    // The workers' allocations count towards the calling thread's script,
+    // and their symbols go into its table.
+    stats::Account& account = stats::currentAccount();
+    symbol::SymbolTable& symbols = symbol::table();
+    for (auto& owned : pieces) {
+        Piece* piece = owned.get();
+        pool.submit([source, piece, &account, &symbols] {
+            stats::Charge charge(account);
+            symbol::Scope scope(symbols);
+            lex(source, *piece);
+        });
+    }
+    pool.wait();
+
+    // Stitch: every piece copies its tokens into its own slice of the result.
+    vector<Token> tokens;
+    size_t total = 1;
+    vector<size_t> offsets;
+    source::LineIndex lines(source);
+    for (auto& piece : pieces) {
+        offsets.push_back(total - 1);
+        total += piece->tokens.size();
+        report(*piece, lines, diagnostics);
+    }
+    tokens.resize(total);
+    for (size_t i = 0; i < pieces.size(); i++) {
+        pool.submit([&, i] {
+            std::copy(pieces[i]->tokens.begin(), pieces[i]->tokens.end(), tokens.begin() + offsets[i]);
+            vector<Token>().swap(pieces[i]->tokens);
+        });
+    }
+    pool.wait();
+    tokens.back() = Token(TokenType::END_OF_FILE, TokenValue(), static_cast<uint32_t>(source.size()));
+    return tokens;
+}
+
+} // namespace scanner
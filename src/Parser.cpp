@@ -1,6 +1,6 @@
 #include "Parser.h"
-#include <iostream>
-#include <AstPrinter.h>
+
+#include <iterator>
 
 using expr::Unary;
 using expr::Binary;
@@ -13,44 +13,71 @@ using std::make_shared;
 
 namespace parser {
 
-Parser::Parser(const std::vector<token::Token>& tokens) : tokens(tokens), current(0) {}
+Parser::Parser(const std::vector<token::Token>& tokens, expr::AstArena& arena)
+    : ownedSource(std::make_unique<VectorTokenSource>(tokens)), tokens(ownedSource.get()), arena(arena), current(0), fetched(0) {}
+
+Parser::Parser(scanner::Scanner& scanner, expr::AstArena& arena)
+    : ownedSource(std::make_unique<ScannerTokenSource>(scanner)), tokens(ownedSource.get()), arena(arena),
+      text(scanner.text()), current(0), fetched(0) {}
+
+Parser::Parser(TokenSource& source, expr::AstArena& arena, string_view text)
+    : tokens(&source), arena(arena), text(text), current(0), fetched(0) {}
 
 Parser::~Parser() {}
 
-void Parser::parse() {
+Expr* Parser::next() {
+    if (isAtEnd()) return nullptr;
+    expr::TreeBuilder builder(arena);
+    return expression(builder);
+}
+
+Expr* Parser::next(diagnostics::Diagnostics& errors) {
+    while (!isAtEnd()) {
+        try {
+            expr::TreeBuilder builder(arena);
+            return expression(builder);
+        } catch (const ParseError& error) {
+            errors.report(diagnostics::Stage::SYNTAX, error.token.offset, error.what());
+            synchronize();
+        }
+    }
+    return nullptr;
+}
+
+Expr* Parser::next(expr::HashConsBuilder& builder) {
+    if (isAtEnd()) return nullptr;
+    return expression(builder);
+}
+
+void Parser::parse(flat::FlatAst& ast) {
     while (!isAtEnd()) {
-        // This is a test case to check if the parser is working correctly
-        auto expr = expression();
-        auto printer = make_shared<printer::AstPrinter>();
-        cout << expr->visit(printer) << endl;
+        ast.roots.push_back(expression(ast));
     }
 }
 
 bool Parser::isAtEnd() {
-    return current >= tokens.size();
+    return peek().type == TokenType::END_OF_FILE;
 }
 
-// TODO(MEDIUM): Use scanner's iterator to get the next token
-// This way, we can avoid storing all the tokens in memory
 const token::Token& Parser::advance() {
     if (!isAtEnd()) current++;
     return previous();
 }
 
 const token::Token& Parser::peek() {
-    if (current >= tokens.size()) {
-        std::cerr << "Error: Attempt to access out-of-bounds token at index " << current << std::endl;
-        exit(EXIT_FAILURE);
+    // Tokens are pulled lazily, one past the last consumed token at most.
+    if (fetched == current) {
+        window[fetched % WINDOW_SIZE] = tokens->next();
+        fetched++;
     }
-    return tokens[current];
+    return slot(current);
 }
 
 const token::Token& Parser::previous() {
     if (current == 0) {
-        std::cerr << "Error: Attempt to access previous token when current is 0" << std::endl;
-        exit(EXIT_FAILURE);
+        throw ParseError(peek(), "Attempt to access previous token when current is 0");
     }
-    return tokens[current - 1];
+    return slot(current - 1);
 }
 
 bool Parser::match(token::TokenType type) {
@@ -62,87 +89,144 @@ bool Parser::match(token::TokenType type) {
     return false;
 }
 
-template<typename... Type>
-bool Parser::match(Type... types) {
-    return (match(types) || ...);
+// How each token type parses: `prefix` when it starts an expression, and
+// `infix`, binding as tightly as `precedence`, when it follows a complete
+// left operand. A null handler means the token cannot appear there.
+template <typename Builder>
+struct Parser::Rule {
+    using Node = typename Builder::Node;
+
+    Node (Parser::*prefix)(Builder&);
+    Node (Parser::*infix)(Builder&, Node);
+    Precedence precedence;
+};
+
+// Indexed by TokenType; new operators only need their row filled in.
+template <typename Builder>
+const Parser::Rule<Builder> Parser::rules[] = {
+    { nullptr,                     nullptr,                   Precedence::NONE },       // NONE
+    { &Parser::grouping<Builder>,  nullptr,                   Precedence::NONE },       // LEFT_PAREN
+    { nullptr,                     nullptr,                   Precedence::NONE },       // RIGHT_PAREN
+    { nullptr,                     nullptr,                   Precedence::NONE },       // LEFT_BRACE
+    { nullptr,                     nullptr,                   Precedence::NONE },       // RIGHT_BRACE
+    { nullptr,                     nullptr,                   Precedence::NONE },       // COMMA
+    { nullptr,                     nullptr,                   Precedence::NONE },       // DOT
+    { &Parser::unary<Builder>,     &Parser::binary<Builder>,  Precedence::TERM },       // MINUS
+    { nullptr,                     &Parser::binary<Builder>,  Precedence::TERM },       // PLUS
+    { nullptr,                     nullptr,                   Precedence::NONE },       // SEMICOLON
+    { nullptr,                     &Parser::binary<Builder>,  Precedence::FACTOR },     // SLASH
+    { nullptr,                     &Parser::binary<Builder>,  Precedence::FACTOR },     // STAR
+    { &Parser::unary<Builder>,     nullptr,                   Precedence::NONE },       // BANG
+    { nullptr,                     &Parser::binary<Builder>,  Precedence::EQUALITY },   // BANG_EQUAL
+    { nullptr,                     nullptr,                   Precedence::NONE },       // EQUAL
+    { nullptr,                     &Parser::binary<Builder>,  Precedence::EQUALITY },   // EQUAL_EQUAL
+    { nullptr,                     &Parser::binary<Builder>,  Precedence::COMPARISON }, // GREATER
+    { nullptr,                     &Parser::binary<Builder>,  Precedence::COMPARISON }, // GREATER_EQUAL
+    { nullptr,                     &Parser::binary<Builder>,  Precedence::COMPARISON }, // LESS
+    { nullptr,                     &Parser::binary<Builder>,  Precedence::COMPARISON }, // LESS_EQUAL
+    { nullptr,                     nullptr,                   Precedence::NONE },       // IDENTIFIER
+    { &Parser::literal<Builder>,   nullptr,                   Precedence::NONE },       // STRING
+    { &Parser::literal<Builder>,   nullptr,                   Precedence::NONE },       // NUMBER
+    { nullptr,                     nullptr,                   Precedence::NONE },       // AND
+    { nullptr,                     nullptr,                   Precedence::NONE },       // CLASS
+    { nullptr,                     nullptr,                   Precedence::NONE },       // ELSE
+    { &Parser::literal<Builder>,   nullptr,                   Precedence::NONE },       // FALSE
+    { nullptr,                     nullptr,                   Precedence::NONE },       // FUN
+    { nullptr,                     nullptr,                   Precedence::NONE },       // FOR
+    { nullptr,                     nullptr,                   Precedence::NONE },       // IF
+    { &Parser::literal<Builder>,   nullptr,                   Precedence::NONE },       // NIL
+    { nullptr,                     nullptr,                   Precedence::NONE },       // OR
+    { nullptr,                     nullptr,                   Precedence::NONE },       // PRINT
+    { nullptr,                     nullptr,                   Precedence::NONE },       // RETURN
+    { nullptr,                     nullptr,                   Precedence::NONE },       // SUPER
+    { nullptr,                     nullptr,                   Precedence::NONE },       // THIS
+    { &Parser::literal<Builder>,   nullptr,                   Precedence::NONE },       // TRUE
+    { nullptr,                     nullptr,                   Precedence::NONE },       // VAR
+    { nullptr,                     nullptr,                   Precedence::NONE },       // WHILE
+    { nullptr,                     nullptr,                   Precedence::NONE },       // END_OF_FILE
+};
+
+template <typename Builder>
+typename Builder::Node Parser::expression(Builder& builder) {
+    return parsePrecedence(builder, Precedence::EQUALITY);
 }
 
-shared_ptr<Expr> Parser::primary() {
-    if (match(TokenType::FALSE)) return make_shared<expr::Literal>(TokenValue(false));
-    if (match(TokenType::TRUE)) return make_shared<expr::Literal>(TokenValue(true));
-    if (match(TokenType::NIL)) return make_shared<expr::Literal>(TokenValue(monostate {}));
-
-    if (match(TokenType::NUMBER, TokenType::STRING)) return make_shared<expr::Literal>(previous().lexeme);
-
-    if (match(TokenType::LEFT_PAREN)) {
-        auto expr = equality();
-        if (!match(TokenType::RIGHT_PAREN)) {
-            std::cerr << "Error: Expected ')' after expression" << std::endl;
-            exit(EXIT_FAILURE);
-        }
-        return make_shared<expr::Grouping>(expr);
+template <typename Builder>
+typename Builder::Node Parser::parsePrecedence(Builder& builder, Precedence precedence) {
+    static_assert(std::size(rules<Builder>) == static_cast<size_t>(TokenType::END_OF_FILE) + 1,
+                  "one rule per token type");
+    if (depth >= MAX_DEPTH) throw ParseError(peek(), "Expression too deeply nested");
+    struct Nesting {
+        uint32_t& depth;
+        ~Nesting() { depth--; }
+    } nesting { ++depth };
+    auto prefix = rules<Builder>[static_cast<size_t>(peek().type)].prefix;
+    if (prefix == nullptr) throw ParseError(peek(), "Expected expression");
+    advance();
+    auto expr = (this->*prefix)(builder);
+    // END_OF_FILE and everything else that is not an infix operator has
+    // NONE, which ends the loop.
+    while (true) {
+        const Rule<Builder>& rule = rules<Builder>[static_cast<size_t>(peek().type)];
+        if (rule.precedence < precedence) break;
+        advance();
+        expr = (this->*rule.infix)(builder, expr);
     }
-    std::cerr << "Error: Expected expression" << std::endl;
-    exit(EXIT_FAILURE);
+    return expr;
 }
 
-shared_ptr<Expr> Parser::unary() {
-    if (match(TokenType::BANG, TokenType::MINUS)) {
-        Token operation = previous();
-        auto rightOperand = unary();
-        return make_shared<Unary>(operation, rightOperand);
+template <typename Builder>
+typename Builder::Node Parser::literal(Builder& builder) {
+    const Token& token = previous();
+    switch (token.type) {
+        case TokenType::FALSE: return builder.literal(TokenValue(false), token);
+        case TokenType::TRUE: return builder.literal(TokenValue(true), token);
+        case TokenType::NIL: return builder.literal(TokenValue(monostate {}), token);
+        default: return builder.literal(token.lexeme, token);
     }
-    return primary();
 }
 
-shared_ptr<Expr> Parser::factor() {
-    auto expr = unary();
-    while(match(TokenType::SLASH, TokenType::STAR)) {
-        Token operation = previous();
-        auto rightOperand = unary();
-        expr = make_shared<Binary>(expr, operation, rightOperand);
+template <typename Builder>
+typename Builder::Node Parser::grouping(Builder& builder) {
+    Token paren = previous();
+    auto expr = expression(builder);
+    if (!match(TokenType::RIGHT_PAREN)) {
+        throw ParseError(peek(), "Expected ')' after expression");
     }
-    return expr;
+    return builder.grouping(expr, paren);
 }
 
-shared_ptr<Expr> Parser::term() {
-    auto expr = factor();
-    while(match(TokenType::MINUS, TokenType::PLUS)) {
-        Token operation = previous();
-        auto rightOperand = factor();
-        expr = make_shared<Binary>(expr, operation, rightOperand);
-    }
-    return expr;
+template <typename Builder>
+typename Builder::Node Parser::unary(Builder& builder) {
+    Token operation = previous();
+    auto rightOperand = parsePrecedence(builder, Precedence::UNARY);
+    return builder.unary(operation, rightOperand);
 }
 
-shared_ptr<Expr> Parser::comparison() {
-    auto expr = term();
-    while(match(TokenType::GREATER, TokenType::GREATER_EQUAL, TokenType::LESS, TokenType::LESS_EQUAL)) {
-        Token operation = previous();
-        auto rightOperand = term();
-        expr = make_shared<Binary>(expr, operation, rightOperand);
-    }
-    return expr;
-}
-
-shared_ptr<Expr> Parser::equality() {
-    auto expr = comparison();
-    while(match(TokenType::BANG_EQUAL, TokenType::EQUAL_EQUAL)) {
-        Token operation = previous();
-        auto rightOperand = comparison();
-        expr = make_shared<Binary>(expr, operation, rightOperand);
-    }
-    return expr;
+// Operators are left-associative: the right operand only takes operators
+// that bind more tightly than this one.
+template <typename Builder>
+typename Builder::Node Parser::binary(Builder& builder, typename Builder::Node left) {
+    Token operation = previous();
+    Precedence precedence = rules<Builder>[static_cast<size_t>(operation.type)].precedence;
+    auto rightOperand = parsePrecedence(builder, static_cast<Precedence>(static_cast<uint8_t>(precedence) + 1));
+    return builder.binary(left, operation, rightOperand);
 }
 
-shared_ptr<Expr> Parser::expression() {
-    return equality();
+// Whether a line break separates the token from the one before it. Without
+// the source text every token counts as a new start.
+bool Parser::startsLine(const Token& token) {
+    if (text.empty()) return true;
+    uint32_t from = previous().end();
+    return from <= token.offset && text.substr(from, token.offset - from).find('\n') != string_view::npos;
 }
 
 void Parser::synchronize() {
     advance();
     while (!isAtEnd()) {
         if (previous().type == token::TokenType::SEMICOLON) return;
+        // Expressions have no terminator; a new line is the next best guess.
+        if (startsLine(peek())) return;
         switch (peek().type) {
             case token::TokenType::CLASS:
             case token::TokenType::FUN:
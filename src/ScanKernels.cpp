@@ -0,0 +1,294 @@
+#include "ScanKernels.h"
+#include "CharClass.h"
+
+#include <bit>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define MAC_X86_KERNELS 1
+#endif
+
+namespace scanner::kernels {
+
+// Portable fallback, driven by the character-class table. Also used by the
+// vector kernels to finish the last partial block of the buffer.
+namespace scalar {
+
+const char* skipBlanks(const char* p, const char* end) {
+    while (p < end && (charClass(*p) & CC_BLANK)) p++;
+    return p;
+}
+
+const char* findLineEnd(const char* p, const char* end) {
+    const void* found = std::memchr(p, '\n', end - p);
+    return found ? static_cast<const char*>(found) : end;
+}
+
+const char* findStringDelimiter(const char* p, const char* end) {
+    while (p < end && *p != '"' && *p != '\\') p++;
+    return p;
+}
+
+const char* skipIdentifier(const char* p, const char* end) {
+    while (p < end && (charClass(*p) & CC_IDENTIFIER)) p++;
+    return p;
+}
+
+const char* skipDigits(const char* p, const char* end) {
+    while (p < end && (charClass(*p) & CC_DIGIT)) p++;
+    return p;
+}
+
+void findNewlines(const char* p, const char* end, const char* base, std::vector<uint32_t>& offsets) {
+    for (; p < end; p++) {
+        if (*p == '\n') offsets.push_back(static_cast<uint32_t>(p - base));
+    }
+}
+
+} // namespace scalar
+
+#if MAC_X86_KERNELS
+
+// Bytes >= 0x80 compare as negative in the signed comparisons below, so they
+// never fall inside the (ASCII) ranges being tested.
+namespace sse2 {
+
+constexpr ptrdiff_t WIDTH = 16;
+
+inline __m128i load(const char* p) {
+    return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+}
+
+inline uint32_t equal(__m128i v, char c) {
+    return static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8(c))));
+}
+
+inline uint32_t inRange(__m128i v, char low, char high) {
+    __m128i above = _mm_cmpgt_epi8(v, _mm_set1_epi8(static_cast<char>(low - 1)));
+    __m128i below = _mm_cmplt_epi8(v, _mm_set1_epi8(static_cast<char>(high + 1)));
+    return static_cast<uint32_t>(_mm_movemask_epi8(_mm_and_si128(above, below)));
+}
+
+inline uint32_t stopMask(uint32_t runMask) {
+    return ~runMask & 0xFFFFu;
+}
+
+const char* skipBlanks(const char* p, const char* end) {
+    for (; end - p >= WIDTH; p += WIDTH) {
+        __m128i v = load(p);
+        uint32_t stop = stopMask(equal(v, '\n') | equal(v, ' ') | equal(v, '\t') | equal(v, '\r'));
+        if (stop) return p + std::countr_zero(stop);
+    }
+    return scalar::skipBlanks(p, end);
+}
+
+const char* findLineEnd(const char* p, const char* end) {
+    for (; end - p >= WIDTH; p += WIDTH) {
+        uint32_t hit = equal(load(p), '\n');
+        if (hit) return p + std::countr_zero(hit);
+    }
+    return scalar::findLineEnd(p, end);
+}
+
+const char* findStringDelimiter(const char* p, const char* end) {
+    for (; end - p >= WIDTH; p += WIDTH) {
+        __m128i v = load(p);
+        uint32_t hit = equal(v, '"') | equal(v, '\\');
+        if (hit) return p + std::countr_zero(hit);
+    }
+    return scalar::findStringDelimiter(p, end);
+}
+
+const char* skipIdentifier(const char* p, const char* end) {
+    for (; end - p >= WIDTH; p += WIDTH) {
+        __m128i v = load(p);
+        // Setting bit 5 folds 'A'-'Z' onto 'a'-'z' without pulling in any other byte.
+        uint32_t letters = inRange(_mm_or_si128(v, _mm_set1_epi8(0x20)), 'a', 'z');
+        uint32_t stop = stopMask(letters | inRange(v, '0', '9') | equal(v, '_'));
+        if (stop) return p + std::countr_zero(stop);
+    }
+    return scalar::skipIdentifier(p, end);
+}
+
+const char* skipDigits(const char* p, const char* end) {
+    for (; end - p >= WIDTH; p += WIDTH) {
+        uint32_t stop = stopMask(inRange(load(p), '0', '9'));
+        if (stop) return p + std::countr_zero(stop);
+    }
+    return scalar::skipDigits(p, end);
+}
+
+void findNewlines(const char* p, const char* end, const char* base, std::vector<uint32_t>& offsets) {
+    for (; end - p >= WIDTH; p += WIDTH) {
+        for (uint32_t hit = equal(load(p), '\n'); hit != 0; hit &= hit - 1) {
+            offsets.push_back(static_cast<uint32_t>(p - base + std::countr_zero(hit)));
+        }
+    }
+    scalar::findNewlines(p, end, base, offsets);
+}
+
+} // namespace sse2
+
+#define MAC_AVX2 __attribute__((target("avx2")))
+
+namespace avx2 {
+
+constexpr ptrdiff_t WIDTH = 32;
+
+MAC_AVX2 inline __m256i load(const char* p) {
+    return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+}
+
+MAC_AVX2 inline uint32_t equal(__m256i v, char c) {
+    return static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(c))));
+}
+
+MAC_AVX2 inline uint32_t inRange(__m256i v, char low, char high) {
+    __m256i above = _mm256_cmpgt_epi8(v, _mm256_set1_epi8(static_cast<char>(low - 1)));
+    __m256i below = _mm256_cmpgt_epi8(_mm256_set1_epi8(static_cast<char>(high + 1)), v);
+    return static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_and_si256(above, below)));
+}
+
+MAC_AVX2 const char* skipBlanks(const char* p, const char* end) {
+    for (; end - p >= WIDTH; p += WIDTH) {
+        __m256i v = load(p);
+        uint32_t stop = ~(equal(v, '\n') | equal(v, ' ') | equal(v, '\t') | equal(v, '\r'));
+        if (stop) return p + std::countr_zero(stop);
+    }
+    return sse2::skipBlanks(p, end);
+}
+
+MAC_AVX2 const char* findLineEnd(const char* p, const char* end) {
+    for (; end - p >= WIDTH; p += WIDTH) {
+        uint32_t hit = equal(load(p), '\n');
+        if (hit) return p + std::countr_zero(hit);
+    }
+    return sse2::findLineEnd(p, end);
+}
+
+MAC_AVX2 const char* findStringDelimiter(const char* p, const char* end) {
+    for (; end - p >= WIDTH; p += WIDTH) {
+        __m256i v = load(p);
+        uint32_t hit = equal(v, '"') | equal(v, '\\');
+        if (hit) return p + std::countr_zero(hit);
+    }
+    return sse2::findStringDelimiter(p, end);
+}
+
+MAC_AVX2 const char* skipIdentifier(const char* p, const char* end) {
+    for (; end - p >= WIDTH; p += WIDTH) {
+        __m256i v = load(p);
+        uint32_t letters = inRange(_mm256_or_si256(v, _mm256_set1_epi8(0x20)), 'a', 'z');
+        uint32_t stop = ~(letters | inRange(v, '0', '9') | equal(v, '_'));
+        if (stop) return p + std::countr_zero(stop);
+    }
+    return sse2::skipIdentifier(p, end);
+}
+
+MAC_AVX2 const char* skipDigits(const char* p, const char* end) {
+    for (; end - p >= WIDTH; p += WIDTH) {
+        uint32_t stop = ~inRange(load(p), '0', '9');
+        if (stop) return p + std::countr_zero(stop);
+    }
+    return sse2::skipDigits(p, end);
+}
+
+MAC_AVX2 void findNewlines(const char* p, const char* end, const char* base, std::vector<uint32_t>& offsets) {
+    for (; end - p >= WIDTH; p += WIDTH) {
+        for (uint32_t hit = equal(load(p), '\n'); hit != 0; hit &= hit - 1) {
+            offsets.push_back(static_cast<uint32_t>(p - base + std::countr_zero(hit)));
+        }
+    }
+    sse2::findNewlines(p, end, base, offsets);
+}
+
+} // namespace avx2
+
+#endif // MAC_X86_KERNELS
+
+namespace {
+
+struct KernelTable {
+    Level level;
+    const char* (*skipBlanks)(const char*, const char*);
+    const char* (*findLineEnd)(const char*, const char*);
+    const char* (*findStringDelimiter)(const char*, const char*);
+    const char* (*skipIdentifier)(const char*, const char*);
+    const char* (*skipDigits)(const char*, const char*);
+    void (*findNewlines)(const char*, const char*, const char*, std::vector<uint32_t>&);
+};
+
+#define MAC_KERNEL_TABLE(level, ns) \
+    KernelTable { level, ns::skipBlanks, ns::findLineEnd, ns::findStringDelimiter, ns::skipIdentifier, ns::skipDigits, \
+                  ns::findNewlines }
+
+Level detectLevel() {
+    Level level = Level::SCALAR;
+#if MAC_X86_KERNELS
+    level = Level::SSE2; // part of the x86-64 baseline
+    if (__builtin_cpu_supports("avx2")) level = Level::AVX2;
+#endif
+    if (const char* cap = std::getenv("MAC_SIMD")) {
+        Level requested = level;
+        if (std::strcmp(cap, "scalar") == 0) requested = Level::SCALAR;
+        else if (std::strcmp(cap, "sse2") == 0) requested = Level::SSE2;
+        if (requested < level) level = requested;
+    }
+    return level;
+}
+
+const KernelTable& kernels() {
+    static const KernelTable table = [] {
+        switch (detectLevel()) {
+#if MAC_X86_KERNELS
+            case Level::AVX2: return MAC_KERNEL_TABLE(Level::AVX2, avx2);
+            case Level::SSE2: return MAC_KERNEL_TABLE(Level::SSE2, sse2);
+#endif
+            default: return MAC_KERNEL_TABLE(Level::SCALAR, scalar);
+        }
+    }();
+    return table;
+}
+
+} // namespace
+
+Level activeLevel() {
+    return kernels().level;
+}
+
+const char* levelName(Level level) {
+    switch (level) {
+        case Level::SSE2: return "sse2";
+        case Level::AVX2: return "avx2";
+        default: return "scalar";
+    }
+}
+
+const char* skipBlanks(const char* begin, const char* end) {
+    return kernels().skipBlanks(begin, end);
+}
+
+const char* findLineEnd(const char* begin, const char* end) {
+    return kernels().findLineEnd(begin, end);
+}
+
+const char* findStringDelimiter(const char* begin, const char* end) {
+    return kernels().findStringDelimiter(begin, end);
+}
+
+const char* skipIdentifier(const char* begin, const char* end) {
+    return kernels().skipIdentifier(begin, end);
+}
+
+const char* skipDigits(const char* begin, const char* end) {
+    return kernels().skipDigits(begin, end);
+}
+
+void findNewlines(const char* begin, const char* end, std::vector<uint32_t>& offsets) {
+    kernels().findNewlines(begin, end, begin, offsets);
+}
+
+} // namespace scanner::kernels
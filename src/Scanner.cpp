@@ -1,5 +1,8 @@
 #include "Scanner.h"
+#include "ScanKernels.h"
 
+#include <charconv>
+#include <cmath>
 #include <memory>
 
 using std::monostate;
@@ -10,131 +13,134 @@ namespace scanner {
 
     Token Scanner::scanToken() {
         while(!isAtEnd()) {
-            char c = advance();
-            if (isWhitespace(c)) continue;
-            if (c == '\n') {
-                line++;
+            // One table lookup decides between the bulk paths and the
+            // single switch over punctuation below.
+            uint8_t cls = charClass(source[current]);
+            if (cls & CC_BLANK) {
+                moveTo(kernels::skipBlanks(cursor(), sourceEnd()));
                 continue;
             }
-            start = current - 1;
-            TokenType type = TokenType::NONE;
-            switch (c) {
-                case '(': type = TokenType::LEFT_PAREN; break;
-                case ')': type = TokenType::RIGHT_PAREN; break;
-                case '{': type = TokenType::LEFT_BRACE; break;
-                case '}': type = TokenType::RIGHT_BRACE; break;
-                case ',': type = TokenType::COMMA; break;
-                case '.': type = TokenType::DOT; break;
-                case '-': type = TokenType::MINUS; break;
-                case '+': type = TokenType::PLUS; break;
-                case ';': type = TokenType::SEMICOLON; break;
-                case '*': type = TokenType::STAR; break;
-                default:
-                    break;
-            }
-            if (type != TokenType::NONE) {
-                string lexeme = string(1, c);
-                return Token(type, TokenValue(lexeme), line);
-            }
-
-            // two character tokens
-            type = TokenType::NONE; // Reset type to NONE
-            switch(c) {
-                case '!':
-                    if (match('=')) {
-                        type = TokenType::BANG_EQUAL;
-                    } else {
-                        type = TokenType::BANG;
-                    }
-                    break;
-                case '=':
-                    if (match('=')) {
-                        type = TokenType::EQUAL_EQUAL;
-                    } else {
-                        type = TokenType::EQUAL;
-                    }
-                    break;
-                case '>':
-                    if (match('=')) {
-                        type = TokenType::GREATER_EQUAL;
-                    } else {
-                        type = TokenType::GREATER;
-                    }
-                    break;
-                case '<':
-                    if (match('=')) {
-                        type = TokenType::LESS_EQUAL;
-                    } else {
-                        type = TokenType::LESS;
-                    }
-                    break;
-                default:
-                    break;
-                }
 
-            if (type != TokenType::NONE) {
-                string lexeme = source.substr(start, current - start);
-                return Token(type, TokenValue(lexeme), line);
-            }
+            start = current;
+            char c = advance();
+            if (cls & CC_ALPHA) return identifier();
+            if (cls & CC_DIGIT) return number();
 
-            // Longer lexemes
-            type = TokenType::NONE; // Reset type to NONE
             switch (c) {
+                // single character tokens
+                case '(': return makeToken(TokenType::LEFT_PAREN);
+                case ')': return makeToken(TokenType::RIGHT_PAREN);
+                case '{': return makeToken(TokenType::LEFT_BRACE);
+                case '}': return makeToken(TokenType::RIGHT_BRACE);
+                case ',': return makeToken(TokenType::COMMA);
+                case '.': return makeToken(TokenType::DOT);
+                case '-': return makeToken(TokenType::MINUS);
+                case '+': return makeToken(TokenType::PLUS);
+                case ';': return makeToken(TokenType::SEMICOLON);
+                case '*': return makeToken(TokenType::STAR);
+
+                // two character tokens
+                case '!': return makeToken(match('=') ? TokenType::BANG_EQUAL : TokenType::BANG);
+                case '=': return makeToken(match('=') ? TokenType::EQUAL_EQUAL : TokenType::EQUAL);
+                case '>': return makeToken(match('=') ? TokenType::GREATER_EQUAL : TokenType::GREATER);
+                case '<': return makeToken(match('=') ? TokenType::LESS_EQUAL : TokenType::LESS);
+
+                // Longer lexemes
                 case '/':
                     if (match('/')) {
-                        while (peek() != '\n' && !isAtEnd()) advance();
-                    } else {
-                        type = TokenType::SLASH;
+                        moveTo(kernels::findLineEnd(cursor(), sourceEnd()));
+                        continue;
                     }
-                    break;
+                    return makeToken(TokenType::SLASH);
                 case '"':
-                    while (peek() != '"' && !isAtEnd()) {
-                        if (peek() == '\n') line++;
-                        advance();
-                    }
-                    if (isAtEnd()) {
-                        cout << "Unterminated string on line " << line << std::endl;
-                        return Token(TokenType::NONE, TokenValue(), line);
-                    } else {
-                        advance(); // closing "
-                        TokenValue literal = source.substr(start + 1, current - start - 2); // Exclude the quotes
-                        return Token(TokenType::STRING, literal, line);
-                    }
+                    return stringLiteral();
                 default:
-                    if(isdigit(c)) {
-                        while (isDigit(peek())) advance();
-                        // Look for a fractional part.
-                        if (peek() == '.' && isDigit(peekNext())) {
-                            // Consume the "."
-                            advance();
-
-                            while (isDigit(peek())) advance();
-                        }
-                        string lexeme = source.substr(start, current - start);
-                        return Token(TokenType::NUMBER, stod(lexeme), line);
-                    } else if (isAlpha(c)) {
-                        // Consume each alphanumeric character up to the maximum length
-                        while (isAlphaNumeric(peek())) advance();
-                        TokenType tokenType = TokenType::IDENTIFIER;
-                        string identifier = source.substr(start, current - start);
-                        // If the matched identifier is a keyword, set the type accordingly
-                        if (keywords.find(identifier) != keywords.end()) {
-                            tokenType = keywords[identifier]; // Override type here
-                        }
-                        return Token(tokenType, TokenValue(identifier), line);
-                    } else {
-                        cout << "Unexpected character on line " << line << std::endl;
-                        return Token(TokenType::NONE, TokenValue(), line);
-                    }
+                    reportError("Unexpected character");
+                    return makeToken(TokenType::NONE, TokenValue());
             }
+        }
+        return Token(TokenType::END_OF_FILE, TokenValue(), static_cast<uint32_t>(source.length()));
+    }
 
-            if (type != TokenType::NONE) {
-                string lexeme = source.substr(start, current - start);
-                return Token(type, TokenValue(lexeme), line);
-            }
+    Token Scanner::identifier() {
+        // Consume each alphanumeric character up to the maximum length
+        moveTo(kernels::skipIdentifier(cursor(), sourceEnd()));
+        string_view identifier = source.substr(start, current - start);
+        // If the matched identifier is a keyword, the type is the keyword's
+        TokenType tokenType = lookupKeyword(identifier);
+        if (tokenType == TokenType::IDENTIFIER) return makeToken(tokenType, TokenValue(symbol::intern(identifier)));
+        return makeToken(tokenType, TokenValue(identifier));
+    }
+
+    // Up to this many digits always fit in an int64_t.
+    constexpr size_t MAX_EXACT_DIGITS = 18;
+
+    Token Scanner::number() {
+        moveTo(kernels::skipDigits(cursor(), sourceEnd()));
+        size_t integerEnd = current;
+        // Look for a fractional part.
+        if (peek() == '.' && isDigit(peekNext())) {
+            // Consume the "."
+            advance();
+
+            moveTo(kernels::skipDigits(cursor(), sourceEnd()));
+        } else if (current - start <= MAX_EXACT_DIGITS) {
+            // The common case, accumulated in place.
+            int64_t value = 0;
+            for (size_t i = start; i < current; i++) value = value * 10 + (source[i] - '0');
+            return makeToken(TokenType::NUMBER, TokenValue(value));
+        }
+
+        // Parsed in place: no copy, no locale, and no exception on overflow.
+        double value = 0;
+        auto [end, error] = std::from_chars(source.data() + start, source.data() + current, value);
+        if (error == std::errc::result_out_of_range) {
+            // Too large, or a fraction too small to represent.
+            bool large = source.substr(start, integerEnd - start).find_first_not_of('0') != string_view::npos;
+            value = large ? HUGE_VAL : 0.0;
+        }
+        return makeToken(TokenType::NUMBER, TokenValue(value));
+    }
 
+    Token Scanner::stringLiteral() {
+        bool escaped = false;
+        while (true) {
+            moveTo(kernels::findStringDelimiter(cursor(), sourceEnd()));
+            if (peek() != '\\' || current + 1 >= source.length()) break;
+            // Skip the backslash and the character it escapes.
+            escaped = true;
+            current += 2;
+        }
+        if (peek() != '"') {
+            // Ran off the end, possibly past a dangling backslash.
+            current = source.length();
+            reportError("Unterminated string");
+            return makeToken(TokenType::NONE, TokenValue());
+        }
+        advance(); // closing "
+        string_view literal = source.substr(start + 1, current - start - 2); // Exclude the quotes
+        symbol::Symbol symbol = escaped ? symbol::intern(unescape(literal)) : symbol::intern(literal);
+        return makeToken(TokenType::STRING, TokenValue(symbol));
+    }
+
+    string Scanner::unescape(string_view body) {
+        string decoded;
+        decoded.reserve(body.length());
+        for (size_t i = 0; i < body.length(); i++) {
+            char c = body[i];
+            if (c != '\\' || i + 1 == body.length()) {
+                decoded.push_back(c);
+                continue;
+            }
+            switch (body[++i]) {
+                case 'n': decoded.push_back('\n'); break;
+                case 't': decoded.push_back('\t'); break;
+                case 'r': decoded.push_back('\r'); break;
+                case '0': decoded.push_back('\0'); break;
+                default: decoded.push_back(body[i]); break; // \", \\ and unknown escapes
+            }
         }
-        return Token(TokenType::END_OF_FILE, TokenValue(), line);
+        return decoded;
     }
 
 } // namespace scanner
\ No newline at end of file
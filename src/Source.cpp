@@ -0,0 +1,147 @@
+#include "Source.h"
+
+#include <utility>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define MAC_HAVE_MMAP 1
+#else
+#include <fstream>
+#include <iterator>
+#endif
+
+namespace source {
+
+#if MAC_HAVE_MMAP
+
+SourceFile::SourceFile(const char* path, size_t limit) {
+    int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return;
+
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        ::close(fd);
+        return;
+    }
+
+    if (S_ISREG(info.st_mode) && static_cast<uintmax_t>(info.st_size) > limit) {
+        tooLarge = true;
+        ::close(fd);
+        return;
+    }
+
+    if (S_ISREG(info.st_mode) && info.st_size > 0) {
+        size_t fileSize = static_cast<size_t>(info.st_size);
+        void* region = mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (region != MAP_FAILED) {
+            // The scanner walks the file front to back exactly once.
+            madvise(region, fileSize, MADV_SEQUENTIAL);
+            data = static_cast<const char*>(region);
+            length = fileSize;
+            mapped = true;
+            opened = true;
+            ::close(fd);
+            return;
+        }
+    }
+
+    size_t sizeHint = S_ISREG(info.st_mode) ? static_cast<size_t>(info.st_size) : 0;
+    opened = readAll(fd, sizeHint, limit);
+    ::close(fd);
+}
+
+bool SourceFile::readAll(int fd, size_t sizeHint, size_t limit) {
+    // Pipes report no size up front, so start from a page-sized block and
+    // double it whenever it fills up.
+    size_t capacity = sizeHint > 0 ? sizeHint + 1 : 64 * 1024;
+    buffer.resize(capacity);
+    size_t filled = 0;
+    while (true) {
+        if (filled == buffer.size()) buffer.resize(buffer.size() * 2);
+        ssize_t count = ::read(fd, buffer.data() + filled, buffer.size() - filled);
+        if (count < 0) {
+            // A signal arriving before any data is not an error.
+            if (errno == EINTR) continue;
+            return false;
+        }
+        if (count == 0) break;
+        filled += static_cast<size_t>(count);
+        if (filled > limit) {
+            tooLarge = true;
+            buffer.clear();
+            return false;
+        }
+    }
+    buffer.resize(filled);
+    data = buffer.data();
+    length = filled;
+    return true;
+}
+
+void SourceFile::release() {
+    if (mapped) munmap(const_cast<char*>(data), length);
+    data = nullptr;
+    length = 0;
+    mapped = false;
+    opened = false;
+    tooLarge = false;
+    buffer.clear();
+}
+
+#else
+
+SourceFile::SourceFile(const char* path, size_t limit) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) return;
+    buffer.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    if (buffer.size() > limit) {
+        tooLarge = true;
+        buffer.clear();
+        return;
+    }
+    data = buffer.data();
+    length = buffer.size();
+    opened = true;
+}
+
+bool SourceFile::readAll(int, size_t, size_t) {
+    return false;
+}
+
+void SourceFile::release() {
+    data = nullptr;
+    length = 0;
+    opened = false;
+    tooLarge = false;
+    buffer.clear();
+}
+
+#endif
+
+SourceFile::~SourceFile() {
+    release();
+}
+
+SourceFile::SourceFile(SourceFile&& other) noexcept {
+    *this = std::move(other);
+}
+
+SourceFile& SourceFile::operator=(SourceFile&& other) noexcept {
+    if (this == &other) return *this;
+    release();
+    mapped = std::exchange(other.mapped, false);
+    tooLarge = std::exchange(other.tooLarge, false);
+    opened = std::exchange(other.opened, false);
+    length = std::exchange(other.length, 0);
+    data = std::exchange(other.data, nullptr);
+    buffer = std::move(other.buffer);
+    // A moved string may have relocated its small-buffer storage.
+    if (!mapped && opened) data = buffer.data();
+    return *this;
+}
+
+} // namespace source
@@ -0,0 +1,205 @@
+#include "Stats.h"
+
+#include <cstdio>
+#include <fstream>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#include <unistd.h>
+#define MAC_HAVE_RUSAGE 1
+#endif
+
+namespace stats {
+
+namespace {
+
+    const char* const PHASE_NAMES[PHASE_COUNT] = { "load", "lex", "parse", "print", "eval" };
+
+    thread_local Account own;
+    thread_local Account* charged = nullptr; // set by a Charge
+
+    // Small, stable thread numbers for the trace viewer.
+    uint32_t threadNumber() {
+        static std::atomic<uint32_t> next { 1 };
+        thread_local uint32_t number = next++;
+        return number;
+    }
+
+    void writeJsonString(std::ostream& out, string_view text) {
+        out << '"';
+        for (char c : text) {
+            if (c == '"' || c == '\\') {
+                out << '\\' << c;
+            } else if (static_cast<unsigned char>(c) < 0x20) {
+                char escaped[8];
+                std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                out << escaped;
+            } else {
+                out << c;
+            }
+        }
+        out << '"';
+    }
+
+    class NodeCounter : public expr::Visitor<NodeCounter, size_t> {
+    public:
+        size_t visitBinaryExpr(expr::Binary* expr) {
+            // Down the left operands in a loop, so long chains cannot exhaust the stack.
+            size_t count = 0;
+            expr::Expr* node = expr;
+            for (; node->kind == expr::ExprKind::BINARY; node = static_cast<expr::Binary*>(node)->left) {
+                count += 1 + visit(static_cast<expr::Binary*>(node)->right);
+            }
+            return count + visit(node);
+        }
+        size_t visitUnaryExpr(expr::Unary* expr) { return 1 + visit(expr->right); }
+        size_t visitLiteralExpr(expr::Literal*) { return 1; }
+        size_t visitGroupingExpr(expr::Grouping* expr) { return 1 + visit(expr->expression); }
+        size_t visitVariableExpr(expr::Variable*) { return 1; }
+    };
+
+} // namespace
+
+const char* phaseName(Phase phase) {
+    return PHASE_NAMES[static_cast<size_t>(phase)];
+}
+
+Account& currentAccount() {
+    return charged != nullptr ? *charged : own;
+}
+
+Charge::Charge(Account& account) : previous(charged) {
+    charged = &account;
+}
+
+Charge::~Charge() {
+    charged = previous;
+}
+
+size_t peakRss() {
+#if MAC_HAVE_RUSAGE
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+#if defined(__APPLE__)
+    return static_cast<size_t>(usage.ru_maxrss); // bytes
+#else
+    return static_cast<size_t>(usage.ru_maxrss) * 1024; // kilobytes
+#endif
+#else
+    return 0;
+#endif
+}
+
+size_t countNodes(expr::Expr* root) {
+    return NodeCounter().visit(root);
+}
+
+void Trace::event(string_view name, string_view script, Clock::time_point start, Clock::time_point end) {
+    using std::chrono::duration_cast;
+    using std::chrono::microseconds;
+    Event event { string(name), string(script), duration_cast<microseconds>(start - origin).count(),
+                  duration_cast<microseconds>(end - start).count(), threadNumber() };
+    std::lock_guard<std::mutex> guard(lock);
+    events.push_back(std::move(event));
+}
+
+bool Trace::write() const {
+    std::ofstream out(path);
+    if (!out) return false;
+#if MAC_HAVE_RUSAGE
+    long pid = static_cast<long>(getpid());
+#else
+    long pid = 1;
+#endif
+    std::lock_guard<std::mutex> guard(lock);
+    out << "{\"traceEvents\":[";
+    for (size_t i = 0; i < events.size(); i++) {
+        const Event& event = events[i];
+        out << (i == 0 ? "\n" : ",\n") << "{\"name\":\"" << event.name << "\",\"cat\":\"mac\",\"ph\":\"X\",\"ts\":"
+            << event.start << ",\"dur\":" << event.duration << ",\"pid\":" << pid << ",\"tid\":" << event.thread
+            << ",\"args\":{\"script\":";
+        writeJsonString(out, event.script);
+        out << "}}";
+    }
+    out << "\n],\"displayTimeUnit\":\"ms\"}\n";
+    return static_cast<bool>(out);
+}
+
+void Recorder::print(std::ostream& out, bool json) const {
+    if (json) {
+        out << "{\"script\":";
+        writeJsonString(out, script);
+        out << ",\"phases\":[";
+        bool first = true;
+        for (size_t i = 0; i < PHASE_COUNT; i++) {
+            const PhaseStats& phase = phases[i];
+            if (!phase.ran) continue;
+            out << (first ? "" : ",") << "{\"phase\":\"" << PHASE_NAMES[i] << "\",\"wall_ms\":" << phase.seconds * 1e3
+                << ",\"tokens\":" << phase.tokens << ",\"nodes\":" << phase.nodes
+                << ",\"allocations\":" << phase.allocations << ",\"allocated_bytes\":" << phase.allocatedBytes
+                << ",\"peak_rss_bytes\":" << phase.peakRss << '}';
+            first = false;
+        }
+        out << "]}\n";
+        return;
+    }
+
+    char line[160];
+    std::snprintf(line, sizeof(line), "%-7s %10s %10s %10s %10s %14s %12s\n",
+                  "phase", "wall ms", "tokens", "nodes", "allocs", "alloc bytes", "peak RSS KB");
+    out << line;
+    for (size_t i = 0; i < PHASE_COUNT; i++) {
+        const PhaseStats& phase = phases[i];
+        if (!phase.ran) continue;
+        std::snprintf(line, sizeof(line), "%-7s %10.3f %10llu %10llu %10llu %14llu %12zu\n",
+                      PHASE_NAMES[i], phase.seconds * 1e3, static_cast<unsigned long long>(phase.tokens),
+                      static_cast<unsigned long long>(phase.nodes), static_cast<unsigned long long>(phase.allocations),
+                      static_cast<unsigned long long>(phase.allocatedBytes), phase.peakRss / 1024);
+        out << line;
+    }
+}
+
+void Scope::begin(Phase phase, bool outer) {
+    this->phase = phase;
+    this->outer = outer;
+    if (outer) {
+        touched = recorder->touched;
+        recorder->touched = 0;
+    }
+    attributedSeconds = recorder->attributedSeconds;
+    attributed = recorder->attributed;
+    allocations = currentAccount().read();
+    start = Clock::now();
+}
+
+void Scope::end() {
+    Clock::time_point finish = Clock::now();
+    double seconds = std::chrono::duration<double>(finish - start).count();
+    // Leave out what scopes nested in this one already counted.
+    double own = seconds - (recorder->attributedSeconds - attributedSeconds);
+    Allocations totals = currentAccount().read();
+    uint64_t count = totals.count - allocations.count - (recorder->attributed.count - attributed.count);
+    uint64_t bytes = totals.bytes - allocations.bytes - (recorder->attributed.bytes - attributed.bytes);
+
+    PhaseStats& stats = (*recorder)[phase];
+    stats.ran = true;
+    stats.seconds += own;
+    stats.allocations += count;
+    stats.allocatedBytes += bytes;
+    recorder->attributedSeconds += own;
+    recorder->attributed.count += count;
+    recorder->attributed.bytes += bytes;
+    recorder->touched |= 1u << static_cast<unsigned>(phase);
+    if (!outer) return;
+
+    size_t rss = peakRss();
+    for (size_t i = 0; i < PHASE_COUNT; i++) {
+        if (recorder->touched & (1u << i)) recorder->phases[i].peakRss = rss;
+    }
+    recorder->touched |= touched;
+    if (recorder->trace != nullptr) {
+        recorder->trace->event(PHASE_NAMES[static_cast<size_t>(phase)], recorder->script, start, finish);
+    }
+}
+
+} // namespace stats
@@ -0,0 +1,79 @@
+#include "Symbol.h"
+
+#include <cstring>
+#include <functional>
+#include <stdexcept>
+
+namespace symbol {
+
+namespace {
+
+    thread_local SymbolTable* scoped = nullptr; // set by a Scope
+
+} // namespace
+
+Symbol SymbolTable::intern(string_view text) {
+    size_t hash = std::hash<string_view>{}(text);
+    size_t shardIndex = (hash >> 7) & (SHARD_COUNT - 1);
+    Shard& shard = shards[shardIndex];
+
+    std::lock_guard<std::mutex> guard(shard.lock);
+    auto found = shard.symbols.find(text);
+    if (found != shard.symbols.end()) return found->second;
+
+    size_t index = shard.symbols.size();
+    if (text.size() > UINT32_MAX || index >= (size_t(1) << (32 - SHARD_BITS))) {
+        throw std::length_error("symbol table is full");
+    }
+    char* chars = static_cast<char*>(shard.text.allocate(text.size() + 1, 1));
+    std::memcpy(chars, text.data(), text.size());
+    chars[text.size()] = '\0';
+    shard.bytes += text.size();
+
+    Symbol symbol(static_cast<uint32_t>(index << SHARD_BITS | shardIndex), static_cast<uint32_t>(text.size()), chars);
+    shard.symbols.emplace(string_view(chars, text.size()), symbol);
+    return symbol;
+}
+
+void SymbolTable::clear() {
+    for (Shard& shard : shards) {
+        std::lock_guard<std::mutex> guard(shard.lock);
+        shard.symbols.clear();
+        shard.text.reset();
+        shard.bytes = 0;
+    }
+}
+
+size_t SymbolTable::size() {
+    size_t total = 0;
+    for (Shard& shard : shards) {
+        std::lock_guard<std::mutex> guard(shard.lock);
+        total += shard.symbols.size();
+    }
+    return total;
+}
+
+size_t SymbolTable::bytes() {
+    size_t total = 0;
+    for (Shard& shard : shards) {
+        std::lock_guard<std::mutex> guard(shard.lock);
+        total += shard.bytes;
+    }
+    return total;
+}
+
+SymbolTable& table() {
+    if (scoped != nullptr) return *scoped;
+    static SymbolTable instance;
+    return instance;
+}
+
+Scope::Scope(SymbolTable& symbols) : previous(scoped) {
+    scoped = &symbols;
+}
+
+Scope::~Scope() {
+    scoped = previous;
+}
+
+} // namespace symbol
@@ -0,0 +1,83 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace concurrency {
+
+ThreadPool::ThreadPool(size_t threads) {
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+    for (size_t i = 0; i < threads; i++) queues.push_back(std::make_unique<Queue>());
+    for (size_t i = 0; i < threads; i++) workers.emplace_back([this, i] { workerLoop(i); });
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> guard(stateLock);
+        stopping = true;
+    }
+    workAvailable.notify_all();
+    for (std::thread& worker : workers) worker.join();
+}
+
+void ThreadPool::submit(Task task) {
+    Queue& queue = *queues[nextQueue.fetch_add(1, std::memory_order_relaxed) % queues.size()];
+    {
+        std::lock_guard<std::mutex> guard(queue.lock);
+        queue.tasks.push_back(std::move(task));
+    }
+    {
+        std::lock_guard<std::mutex> guard(stateLock);
+        queued++;
+        pending++;
+    }
+    workAvailable.notify_one();
+}
+
+void ThreadPool::wait() {
+    std::unique_lock<std::mutex> guard(stateLock);
+    allDone.wait(guard, [this] { return pending == 0; });
+}
+
+bool ThreadPool::take(size_t index, Task& task) {
+    {
+        Queue& own = *queues[index];
+        std::lock_guard<std::mutex> guard(own.lock);
+        if (!own.tasks.empty()) {
+            task = std::move(own.tasks.front());
+            own.tasks.pop_front();
+            return true;
+        }
+    }
+    for (size_t offset = 1; offset < queues.size(); offset++) {
+        Queue& victim = *queues[(index + offset) % queues.size()];
+        std::lock_guard<std::mutex> guard(victim.lock);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.back());
+            victim.tasks.pop_back();
+            return true;
+        }
+    }
+    return false;
+}
+
+void ThreadPool::workerLoop(size_t index) {
+    while (true) {
+        {
+            std::unique_lock<std::mutex> guard(stateLock);
+            workAvailable.wait(guard, [this] { return stopping || queued > 0; });
+            if (queued == 0) return; // stopping, with nothing left to run
+            queued--;
+        }
+        // A task was reserved above, so one of the queues holds it (or will
+        // once its submit() finishes pushing); keep looking until it is found.
+        Task task;
+        while (!take(index, task)) std::this_thread::yield();
+        task();
+
+        std::lock_guard<std::mutex> guard(stateLock);
+        if (--pending == 0) allDone.notify_all();
+    }
+}
+
+} // namespace concurrency
@@ -0,0 +1,88 @@
+#include "TokenPipeline.h"
+
+#include "Diagnostics.h"
+#include "Scanner.h"
+
+namespace parser {
+
+PipelinedTokenSource::PipelinedTokenSource(string_view source, std::ostream& diagnostics)
+    : source(source), diagnostics(diagnostics), lines(source),
+      account(stats::currentAccount()), symbols(symbol::table()),
+      endOfFile(TokenType::END_OF_FILE, TokenValue(), static_cast<uint32_t>(source.size())),
+      producer([this] { produce(); }) {}
+
+PipelinedTokenSource::~PipelinedTokenSource() {
+    // Drain the ring until the scanner thread notices and sends its last batch.
+    stopping.store(true, std::memory_order_relaxed);
+    while (!finished) {
+        finished = ring.front().last;
+        ring.pop();
+    }
+    producer.join();
+}
+
+Token PipelinedTokenSource::next() {
+    while (true) {
+        if (reading == nullptr) {
+            if (finished) return endOfFile;
+            reading = &ring.front();
+            position = 0;
+            reported = 0;
+        }
+        Batch& batch = *reading;
+        while (reported < batch.errors.size() && batch.errors[reported].index == position) {
+            const LexicalError& error = batch.errors[reported++];
+            diagnostics << error.message << " on " << lines.position(error.offset) << std::endl;
+        }
+        if (position < batch.count) {
+            const Token& token = batch.tokens[position++];
+            if (token.type == TokenType::END_OF_FILE) endOfFile = token;
+            return token;
+        }
+
+        bool last = batch.last;
+        std::exception_ptr error = batch.error;
+        ring.pop();
+        reading = nullptr;
+        if (last) {
+            finished = true;
+            if (error) std::rethrow_exception(error);
+        }
+    }
+}
+
+void PipelinedTokenSource::produce() {
+    stats::Charge charge(account);
+    symbol::Scope scope(symbols);
+    diagnostics::Diagnostics found;
+    scanner::Scanner scanner(source, found);
+    ScannerTokenSource tokens(scanner);
+    while (true) {
+        Batch& batch = ring.claim();
+        batch.count = 0;
+        batch.errors.clear();
+        batch.last = stopping.load(std::memory_order_relaxed);
+        batch.error = nullptr;
+        try {
+            while (!batch.last && batch.count < BATCH_SIZE) {
+                Token token = tokens.next();
+                // Errors found while pulling a token go out just before it,
+                // as they would with the scanner on the parser's thread.
+                for (const diagnostics::Diagnostic& diagnostic : found) {
+                    batch.errors.push_back(LexicalError { batch.count, diagnostic.offset, diagnostic.message });
+                }
+                found.clear();
+                batch.tokens[batch.count++] = token;
+                batch.last = token.type == TokenType::END_OF_FILE;
+            }
+        } catch (...) {
+            batch.error = std::current_exception();
+            batch.last = true;
+        }
+        bool last = batch.last;
+        ring.publish();
+        if (last) return;
+    }
+}
+
+} // namespace parser
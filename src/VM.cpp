@@ -0,0 +1,170 @@
+#include "VM.h"
+
+#if defined(__GNUC__) || defined(__clang__)
+#define MAC_COMPUTED_GOTO 1
+#endif
+
+using bytecode::OpCode;
+
+namespace vm {
+
+InterpretResult VM::run(const bytecode::Chunk& chunk) {
+    // The compiler knows how deep the stack gets, so pushes need no checks.
+    stack.resize(chunk.maxStack + 1);
+    Value* top = stack.data();
+    const uint8_t* ip = chunk.code.data();
+    const Value* constants = chunk.constants.data();
+
+#define READ_BYTE() (*ip++)
+#define READ_U24() (ip += 3, static_cast<uint32_t>(ip[-3]) | static_cast<uint32_t>(ip[-2]) << 8 | static_cast<uint32_t>(ip[-1]) << 16)
+#define PUSH(value) (*top++ = (value))
+#define POP() (*--top)
+#define PEEK(distance) (top[-1 - (distance)])
+#define RUNTIME_ERROR(text)                                            \
+    do {                                                               \
+        message = (text);                                              \
+        offset = chunk.sourceOffsetAt(ip - chunk.code.data() - 1);     \
+        return InterpretResult::RUNTIME_ERROR;                         \
+    } while (false)
+// `operation` is one of the runtime:: functions on two numbers; comparisons
+// wrap theirs in Value().
+#define BINARY_NUMBER_OP(operation, left, right)                       \
+    do {                                                               \
+        if (!PEEK(0).isNumber() || !PEEK(1).isNumber()) {              \
+            RUNTIME_ERROR("Operands must be numbers.");                \
+        }                                                              \
+        Value b = POP();                                               \
+        Value a = PEEK(0);                                             \
+        PEEK(0) = Value(runtime::operation(left, right));              \
+    } while (false)
+
+#if MAC_COMPUTED_GOTO
+    // One entry per OpCode, in declaration order.
+    static void* const dispatchTable[] = {
+        &&op_CONSTANT, &&op_CONSTANT_LONG, &&op_NIL, &&op_TRUE, &&op_FALSE, &&op_GET_GLOBAL,
+        &&op_NEGATE, &&op_NOT, &&op_ADD, &&op_SUBTRACT, &&op_MULTIPLY, &&op_DIVIDE,
+        &&op_EQUAL, &&op_NOT_EQUAL, &&op_GREATER, &&op_GREATER_EQUAL, &&op_LESS, &&op_LESS_EQUAL,
+        &&op_PRINT, &&op_RETURN,
+    };
+    static_assert(sizeof(dispatchTable) / sizeof(dispatchTable[0]) == static_cast<size_t>(OpCode::RETURN) + 1);
+#define DISPATCH() goto *dispatchTable[READ_BYTE()]
+#define CASE(op) op_##op:
+    DISPATCH();
+#else
+#define DISPATCH() goto dispatch
+#define CASE(op) case OpCode::op:
+dispatch:
+    switch (static_cast<OpCode>(READ_BYTE())) {
+#endif
+
+    CASE(CONSTANT) {
+        PUSH(constants[READ_BYTE()]);
+        DISPATCH();
+    }
+    CASE(CONSTANT_LONG) {
+        PUSH(constants[READ_U24()]);
+        DISPATCH();
+    }
+    CASE(NIL) {
+        PUSH(Value::nil());
+        DISPATCH();
+    }
+    CASE(TRUE) {
+        PUSH(Value(true));
+        DISPATCH();
+    }
+    CASE(FALSE) {
+        PUSH(Value(false));
+        DISPATCH();
+    }
+    CASE(GET_GLOBAL) {
+        // There are no global definitions yet, so every lookup fails.
+        const runtime::StringObject* name = constants[READ_U24()].asString();
+        RUNTIME_ERROR("Undefined variable '" + string(name->chars) + "'.");
+    }
+    CASE(NEGATE) {
+        if (!PEEK(0).isNumber()) RUNTIME_ERROR("Operand must be a number.");
+        PEEK(0) = runtime::negate(PEEK(0));
+        DISPATCH();
+    }
+    CASE(NOT) {
+        PEEK(0) = Value(!PEEK(0).isTruthy());
+        DISPATCH();
+    }
+    CASE(ADD) {
+        if (PEEK(0).isString() && PEEK(1).isString()) {
+            const runtime::StringObject* right = POP().asString();
+            PEEK(0) = Value(heap.concatenate(PEEK(0).asString()->chars, right->chars));
+            DISPATCH();
+        }
+        if (!PEEK(0).isNumber() || !PEEK(1).isNumber()) {
+            RUNTIME_ERROR("Operands must be two numbers or two strings.");
+        }
+        Value right = POP();
+        PEEK(0) = runtime::add(PEEK(0), right);
+        DISPATCH();
+    }
+    CASE(SUBTRACT) {
+        BINARY_NUMBER_OP(subtract, a, b);
+        DISPATCH();
+    }
+    CASE(MULTIPLY) {
+        BINARY_NUMBER_OP(multiply, a, b);
+        DISPATCH();
+    }
+    CASE(DIVIDE) {
+        BINARY_NUMBER_OP(divide, a, b);
+        DISPATCH();
+    }
+    CASE(EQUAL) {
+        Value right = POP();
+        PEEK(0) = Value(PEEK(0) == right);
+        DISPATCH();
+    }
+    CASE(NOT_EQUAL) {
+        Value right = POP();
+        PEEK(0) = Value(!(PEEK(0) == right));
+        DISPATCH();
+    }
+    CASE(GREATER) {
+        BINARY_NUMBER_OP(less, b, a);
+        DISPATCH();
+    }
+    CASE(GREATER_EQUAL) {
+        BINARY_NUMBER_OP(lessEqual, b, a);
+        DISPATCH();
+    }
+    CASE(LESS) {
+        BINARY_NUMBER_OP(less, a, b);
+        DISPATCH();
+    }
+    CASE(LESS_EQUAL) {
+        BINARY_NUMBER_OP(lessEqual, a, b);
+        DISPATCH();
+    }
+    CASE(PRINT) {
+        runtime::printValue(out, POP());
+        out << '\n';
+        DISPATCH();
+    }
+    CASE(RETURN) {
+        return InterpretResult::OK;
+    }
+
+#if !MAC_COMPUTED_GOTO
+    }
+    return InterpretResult::OK;
+#endif
+
+#undef READ_BYTE
+#undef READ_U24
+#undef PUSH
+#undef POP
+#undef PEEK
+#undef RUNTIME_ERROR
+#undef BINARY_NUMBER_OP
+#undef DISPATCH
+#undef CASE
+}
+
+} // namespace vm
@@ -0,0 +1,72 @@
+// AstCache round trips: a miss parses and saves, a hit loads the same tree,
+// and a file that holds some other script, or is cut short, is a miss that
+// gets rewritten.
+
+#include <filesystem>
+#include <string>
+
+#include "AstCache.h"
+#include "AstPrinter.h"
+#include "Check.h"
+#include "OutputSink.h"
+
+using std::string;
+namespace fs = std::filesystem;
+
+namespace {
+
+    string print(const cache::CachedAst& cached) {
+        output::OutputSink out;
+        printer::FlatAstPrinter printer(cached.ast(), out);
+        for (size_t root = 0; root < cached.ast().roots.size(); root++) printer.print(root);
+        return out.take();
+    }
+
+} // namespace
+
+int main() {
+    const string directory = "AstCacheTest.cache";
+    fs::remove_all(directory);
+    fs::create_directories(directory);
+    cache::AstCache cache(directory);
+
+    const string script = "1 + 2 * 3\n\"a\" + \"b\" == \"ab\"\n!(4 > 3)\n";
+    const string expected = "(+ 1.000000 (* 2.000000 3.000000))\n(== (+ a b) ab)\n(! (group (> 4.000000 3.000000)))\n";
+    const string path = cache.pathFor(cache::contentHash(script));
+
+    auto parsed = cache.get(script);
+    CHECK(parsed != nullptr && !parsed->loaded());
+    CHECK(print(*parsed) == expected);
+    CHECK(fs::exists(path));
+
+    auto loaded = cache.get(script);
+    CHECK(loaded != nullptr && loaded->loaded());
+    CHECK(print(*loaded) == expected);
+    loaded.reset();
+
+    // As if another script's hash collided with this one.
+    const string other = "4 / 5\n";
+    CHECK(cache.get(other) != nullptr);
+    fs::copy_file(cache.pathFor(cache::contentHash(other)), path, fs::copy_options::overwrite_existing);
+    auto mismatched = cache.get(script);
+    CHECK(mismatched != nullptr && !mismatched->loaded());
+    CHECK(print(*mismatched) == expected);
+    auto rewritten = cache.get(script);
+    CHECK(rewritten != nullptr && rewritten->loaded());
+    CHECK(print(*rewritten) == expected);
+    rewritten.reset();
+
+    // A truncated file.
+    fs::resize_file(path, 16);
+    auto truncated = cache.get(script);
+    CHECK(truncated != nullptr && !truncated->loaded());
+    CHECK(print(*truncated) == expected);
+    truncated.reset();
+
+    // Scripts with errors are never cached.
+    CHECK(cache.get("1 +") == nullptr);
+    CHECK(!fs::exists(cache.pathFor(cache::contentHash("1 +"))));
+
+    fs::remove_all(directory);
+    return 0;
+}
@@ -0,0 +1,64 @@
+/*
+ * The C interface, built as C: results, outputs and the stage of each kind
+ * of error, on both the VM and the tree walker. (A compile error takes over
+ * 2^24 constants to provoke, so that stage is only pinned by its value.)
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mac.h"
+
+#define CHECK(condition)                                                                  \
+    do {                                                                                  \
+        if (!(condition)) {                                                               \
+            fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+            exit(1);                                                                      \
+        }                                                                                 \
+    } while (0)
+
+static mac_result* run(mac_engine* engine, const char* source) {
+    mac_result* result = mac_run(engine, source, strlen(source));
+    CHECK(result != NULL);
+    return result;
+}
+
+/* The script fails, and its first error is of `stage`, at `line` and `column`. */
+static void check_error(mac_engine* engine, const char* source, mac_stage stage, int line, int column) {
+    mac_result* result = run(engine, source);
+    CHECK(!mac_result_ok(result));
+    CHECK(mac_result_diagnostic_count(result) >= 1);
+    CHECK(mac_result_diagnostic_stage(result, 0) == stage);
+    CHECK(mac_result_diagnostic_line(result, 0) == line);
+    CHECK(mac_result_diagnostic_column(result, 0) == column);
+    CHECK(strlen(mac_result_diagnostic_message(result, 0)) > 0);
+    mac_result_free(result);
+}
+
+int main(void) {
+    /* Hosts may have stored these. */
+    CHECK(MAC_LEXICAL_ERROR == 0);
+    CHECK(MAC_SYNTAX_ERROR == 1);
+    CHECK(MAC_RUNTIME_ERROR == 2);
+    CHECK(MAC_INTERNAL_ERROR == 3);
+    CHECK(MAC_COMPILE_ERROR == 4);
+
+    for (int use_vm = 0; use_vm <= 1; use_vm++) {
+        mac_engine* engine = mac_engine_new(use_vm);
+        CHECK(engine != NULL);
+
+        mac_result* result = run(engine, "1 + 2\n\"a\" + \"b\"\n");
+        size_t length = 0;
+        CHECK(mac_result_ok(result));
+        CHECK(mac_result_diagnostic_count(result) == 0);
+        CHECK(strcmp(mac_result_output(result, &length), "3\nab\n") == 0);
+        CHECK(length == 5);
+        mac_result_free(result);
+
+        check_error(engine, "1 +\n@", MAC_LEXICAL_ERROR, 2, 1);
+        check_error(engine, "1\n(2", MAC_SYNTAX_ERROR, 2, 3);
+        check_error(engine, "1\n2 - nil", MAC_RUNTIME_ERROR, 2, 3);
+        mac_engine_free(engine);
+    }
+    return 0;
+}
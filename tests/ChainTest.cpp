@@ -0,0 +1,104 @@
+// Operator chains of any length: the parser only limits real nesting, and
+// every walker loops down a chain's left operands instead of recursing.
+
+#include <string>
+
+#include "AstPrinter.h"
+#include "Check.h"
+#include "Engine.h"
+#include "FlatAst.h"
+#include "HashCons.h"
+#include "OutputSink.h"
+#include "Parser.h"
+#include "Scanner.h"
+#include "Stats.h"
+
+using std::string;
+
+namespace {
+
+    constexpr int TERMS = 100000; // far past Parser::MAX_DEPTH
+
+    // "first op 1 op 1 ..." with TERMS terms in all.
+    string chain(const string& first, const string& op) {
+        string source = first;
+        for (int i = 1; i < TERMS; i++) source += " " + op + " 1";
+        return source;
+    }
+
+    string run(const string& source, bool vm, bool fold) {
+        engine::Engine engine(engine::Options { vm, fold });
+        engine::Result result = engine.run(source);
+        CHECK(result.ok());
+        return result.output;
+    }
+
+    string printTree(expr::Expr* root, printer::Format format) {
+        output::OutputSink out;
+        printer::AstPrinter(out, format).print(root);
+        return out.take();
+    }
+
+    string printFlat(const string& source, printer::Format format) {
+        diagnostics::Diagnostics errors;
+        scanner::Scanner scanner(source, errors);
+        expr::AstArena arena;
+        parser::Parser parser(scanner, arena);
+        flat::FlatAst ast;
+        parser.parse(ast);
+        CHECK(errors.empty());
+        output::OutputSink out;
+        printer::FlatAstPrinter(ast, out, format).print(0);
+        return out.take();
+    }
+
+    void checkRejected(const string& source) {
+        engine::Engine engine;
+        diagnostics::Diagnostics errors;
+        engine.parse(source, errors);
+        CHECK(errors.size() == 1);
+        CHECK(errors[0].stage == diagnostics::Stage::SYNTAX);
+        CHECK(errors[0].message == "Expression too deeply nested");
+    }
+
+} // namespace
+
+int main() {
+    // Evaluation order: left-associative subtraction only gives 1 if every
+    // operator runs innermost first.
+    string difference = chain(std::to_string(TERMS), "-");
+    for (bool vm : { false, true }) {
+        for (bool fold : { false, true }) {
+            CHECK(run(difference, vm, fold) == "1\n");
+            CHECK(run(chain("1", "+") + " == " + std::to_string(TERMS), vm, fold) == "true\n");
+        }
+    }
+
+    // Printing, in both forms and from both tree layouts.
+    engine::Engine engine;
+    diagnostics::Diagnostics errors;
+    expr::Expr* small = engine.parse("10 - 1 - 2", errors)[0];
+    CHECK(printTree(small, printer::Format::SEXPR) == "(- (- 10.000000 1.000000) 2.000000)\n");
+    CHECK(printTree(small, printer::Format::JSON)
+          == "{\"binary\":\"-\",\"left\":{\"binary\":\"-\",\"left\":{\"literal\":10},"
+             "\"right\":{\"literal\":1}},\"right\":{\"literal\":2}}\n");
+
+    std::vector<expr::Expr*> roots = engine.parse(difference, errors);
+    CHECK(errors.empty() && roots.size() == 1);
+    for (printer::Format format : { printer::Format::SEXPR, printer::Format::JSON }) {
+        CHECK(printTree(roots[0], format) == printFlat(difference, format));
+    }
+    CHECK(stats::countNodes(roots[0]) == 2 * TERMS - 1);
+
+    engine::Engine other;
+    expr::Expr* twin = other.parse(difference, errors)[0];
+    CHECK(expr::structuralHash(roots[0]) == expr::structuralHash(twin));
+    CHECK(expr::structurallyEqual(roots[0], twin));
+
+    // Real nesting is still limited.
+    string parens = string(5000, '(') + "1" + string(5000, ')');
+    checkRejected(parens);
+    checkRejected(string(5000, '-') + "1");
+    checkRejected(chain("1", "+ (1 +") + string(TERMS - 1, ')'));
+    return 0;
+}
@@ -0,0 +1,18 @@
+#ifndef CHECK_H
+#define CHECK_H
+
+#include <cstdio>
+#include <cstdlib>
+
+// The regression tests are plain programs: a failed CHECK says where and the
+// test exits with a nonzero status, which is what ctest looks at.
+#define CHECK(condition)                                                           \
+    do {                                                                           \
+        if (!(condition)) {                                                        \
+            std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, \
+                         #condition);                                              \
+            std::exit(1);                                                          \
+        }                                                                          \
+    } while (false)
+
+#endif /* CHECK_H */
@@ -0,0 +1,56 @@
+// Deep hash-consed DAGs: x + x nested LEVELS times is LEVELS + 1 nodes but
+// 2^LEVELS paths, so hashing, comparing and folding must visit each shared
+// node once.
+
+#include <cmath>
+#include <string_view>
+
+#include "Check.h"
+#include "ConstantFolder.h"
+#include "HashCons.h"
+
+using expr::Expr;
+
+namespace {
+
+    constexpr int LEVELS = 200;
+
+    const token::Token PLUS(token::TokenType::PLUS, TokenValue(std::string_view("+")), 0);
+
+    Expr* doubling(expr::HashConsBuilder& builder, int64_t leaf) {
+        Expr* node = builder.literal(TokenValue(leaf), token::Token());
+        for (int i = 0; i < LEVELS; i++) node = builder.binary(node, PLUS, node);
+        return node;
+    }
+
+} // namespace
+
+int main() {
+    expr::AstArena arena;
+    expr::HashConsBuilder builder(arena);
+    Expr* one = doubling(builder, 1);
+    CHECK(builder.built() == LEVELS + 1);
+    CHECK(builder.unique() == LEVELS + 1);
+
+    // The same shape from another builder shares nothing with the first.
+    expr::AstArena otherArena;
+    expr::HashConsBuilder other(otherArena);
+    Expr* twin = doubling(other, 1);
+    Expr* two = doubling(other, 2);
+    CHECK(twin != one);
+    CHECK(expr::structuralHash(one) == expr::structuralHash(twin));
+    CHECK(expr::structurallyEqual(one, twin));
+    CHECK(!expr::structurallyEqual(one, two));
+
+    // Folding in shared mode folds each node once and copies nothing it did
+    // not change. 2^200 is past the exact integers, so it comes out a double.
+    optimizer::ConstantFolder folder(arena, true);
+    Expr* folded = folder.fold(one);
+    CHECK(folder.stats().foldedNodes == LEVELS);
+    CHECK(folded->kind == expr::ExprKind::LITERAL);
+    const TokenValue& value = static_cast<expr::Literal*>(folded)->value;
+    CHECK(std::holds_alternative<double>(value));
+    CHECK(std::get<double>(value) == std::ldexp(1.0, LEVELS));
+    CHECK(expr::structurallyEqual(one, twin)); // the DAG itself is unchanged
+    return 0;
+}
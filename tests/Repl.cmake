@@ -0,0 +1,28 @@
+# Pipes tests/ReplInput.txt into the prompt of ${MAC} and compares what it
+# prints. Each line that has run is fixed: "-2" after "1" is a new expression,
+# not "1 - 2", and errors give the lines as they were typed.
+
+execute_process(
+    COMMAND ${MAC} --eval
+    INPUT_FILE ${CMAKE_CURRENT_LIST_DIR}/ReplInput.txt
+    OUTPUT_VARIABLE output
+    ERROR_VARIABLE errors
+    RESULT_VARIABLE status
+)
+
+set(expected_output "|> 1\n|> -2\n|> 5\n|> |> .. |> |> .. 3\n|> ")
+set(expected_errors "Error on line 4, column 1: Expected expression
+Error on line 6, column 1: Expected expression
+Operands must be two numbers or two strings.
+[line 7, column 5]
+")
+
+if(NOT status EQUAL 0)
+    message(FATAL_ERROR "mac exited with ${status}")
+endif()
+if(NOT output STREQUAL expected_output)
+    message(FATAL_ERROR "Output was:\n${output}\nexpected:\n${expected_output}")
+endif()
+if(NOT errors STREQUAL expected_errors)
+    message(FATAL_ERROR "Errors were:\n${errors}\nexpected:\n${expected_errors}")
+endif()